@@ -0,0 +1,135 @@
+/* @file bundle.c
+ *
+ * A C source port of the original Celeste game,
+ * highly optimized for the Nokia N-Gage.
+ *
+ * Original game by Maddy Makes Games.
+ * C source port by lemon32767.
+ *
+ * https://github.com/lemon32767/ccleste
+ *
+ */
+
+ /*
+  * The asset bundle.
+  * celeste_bundle converts the data files ahead of time into what the
+  * frontend ends up keeping in memory: images as PICO-8 color indices and
+  * sounds as PCM in the mixer's format.  The game then reads one file
+  * instead of 25, and skips matching every pixel to the palette and
+  * decoding and resampling every sound.  The file is a 12 byte header,
+  * an index of 32 byte entries and their data:
+  *
+  *   0  "CBDL"           magic
+  *   4  u8 version, u8[3] reserved
+  *   8  u32 entry count
+  *  12  entries of
+  *        0  char[16] name, NUL padded
+  *       16  u32 kind
+  *       20  u32 offset of the data from the start of the file
+  *       24  u32 size of the data in bytes
+  *       28  u16 width, u16 height
+  *
+  * Numbers and samples are little endian, and data starts on 4 byte
+  * boundaries so samples can be used where they are.
+  */
+
+#include "bundle.h"
+
+static Uint32 GetU32(const Uint8* p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((Uint32)p[3] << 24);
+}
+
+static Uint16 GetU16(const Uint8* p)
+{
+    return (Uint16)(p[0] | (p[1] << 8));
+}
+
+int Bundle_Load(Bundle* bundle, const char* path)
+{
+    const Uint8* p;
+    Uint32       count;
+
+    SDL_memset(bundle, 0, sizeof(*bundle));
+    bundle->blob = SDL_LoadFile(path, &bundle->size);
+    if (!bundle->blob)
+    {
+        SDL_Log("Couldn't read bundle '%s': %s", path, SDL_GetError());
+        return false;
+    }
+
+    p = bundle->blob;
+    count = bundle->size >= BUNDLE_HEADER_SIZE ? GetU32(p + 8) : 0;
+    if (bundle->size < BUNDLE_HEADER_SIZE || SDL_memcmp(p, "CBDL", 4) || p[4] != BUNDLE_VERSION ||
+        count > (bundle->size - BUNDLE_HEADER_SIZE) / BUNDLE_ENTRY_SIZE)
+    {
+        SDL_Log("'%s' is not a bundle of this version", path);
+        Bundle_Free(bundle);
+        return false;
+    }
+
+    bundle->entries = SDL_calloc(count + 1, sizeof(*bundle->entries));
+    if (!bundle->entries)
+    {
+        SDL_Log("Out of memory for bundle '%s'", path);
+        Bundle_Free(bundle);
+        return false;
+    }
+    for (p += BUNDLE_HEADER_SIZE; bundle->count < (int)count; p += BUNDLE_ENTRY_SIZE)
+    {
+        Bundle_Entry* entry = &bundle->entries[bundle->count++];
+        Uint32        offset = GetU32(p + 20);
+        Uint32        size = GetU32(p + 24);
+
+        SDL_memcpy(entry->name, p, BUNDLE_NAME_MAX);
+        entry->name[BUNDLE_NAME_MAX - 1] = '\0';
+        entry->kind = (int)GetU32(p + 16);
+        entry->width = GetU16(p + 28);
+        entry->height = GetU16(p + 30);
+        entry->size = size;
+        entry->data = bundle->blob + offset;
+        if (offset > bundle->size || size > bundle->size - offset || (offset & 3) ||
+            (entry->kind == BUNDLE_INDEXED && size != (size_t)entry->width * entry->height) ||
+            (entry->kind == BUNDLE_PCM && (size & 1)))
+        {
+            SDL_Log("Bundle '%s' is truncated at %s", path, entry->name);
+            Bundle_Free(bundle);
+            return false;
+        }
+
+#if SDL_BYTEORDER == SDL_BIG_ENDIAN
+        if (entry->kind == BUNDLE_PCM)
+        {
+            Uint16* samples = (Uint16*)entry->data;
+
+            for (size_t i = 0; i < size / 2; i++)
+            {
+                samples[i] = SDL_Swap16LE(samples[i]);
+            }
+        }
+#endif
+    }
+
+    return true;
+}
+
+const Bundle_Entry* Bundle_Find(const Bundle* bundle, const char* name, int kind)
+{
+    for (int i = 0; i < bundle->count; i++)
+    {
+        const Bundle_Entry* entry = &bundle->entries[i];
+
+        if (entry->kind == kind && !SDL_strcmp(entry->name, name))
+        {
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+void Bundle_Free(Bundle* bundle)
+{
+    SDL_free(bundle->blob);
+    SDL_free(bundle->entries);
+    SDL_memset(bundle, 0, sizeof(*bundle));
+}
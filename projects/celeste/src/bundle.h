@@ -0,0 +1,54 @@
+/* @file bundle.h
+ *
+ * A C source port of the original Celeste game,
+ * highly optimized for the Nokia N-Gage.
+ *
+ * Original game by Maddy Makes Games.
+ * C source port by lemon32767.
+ *
+ * https://github.com/lemon32767/ccleste
+ *
+ */
+
+#ifndef BUNDLE_H
+#define BUNDLE_H
+
+#include <SDL3/SDL.h>
+
+#define BUNDLE_NAME        "celeste.dat"
+#define BUNDLE_VERSION     1
+#define BUNDLE_HEADER_SIZE 12
+#define BUNDLE_ENTRY_SIZE  32
+#define BUNDLE_NAME_MAX    16
+
+// Sounds are stored ready for the mixer as it is opened by Init().
+#define BUNDLE_PCM_RATE 8000
+
+#define BUNDLE_FILE    0 // A data file as it is, like frame.bmp.
+#define BUNDLE_INDEXED 1 // An image as PICO-8 color indices, a byte per pixel.
+#define BUNDLE_PCM     2 // A sound as mono signed 16-bit samples at BUNDLE_PCM_RATE.
+
+typedef struct
+{
+    char   name[BUNDLE_NAME_MAX]; // Of the data file it was made from, like "gfx.bmp".
+    int    kind;
+    int    width, height;         // BUNDLE_INDEXED only.
+    size_t size;
+    Uint8* data;                  // Points into the bundle, in native byte order.
+
+} Bundle_Entry;
+
+typedef struct
+{
+    Uint8*        blob; // The whole file, read at once.
+    size_t        size;
+    Bundle_Entry* entries;
+    int           count;
+
+} Bundle;
+
+int                 Bundle_Load(Bundle* bundle, const char* path);
+const Bundle_Entry* Bundle_Find(const Bundle* bundle, const char* name, int kind);
+void                Bundle_Free(Bundle* bundle);
+
+#endif // BUNDLE_H
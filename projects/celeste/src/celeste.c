@@ -20,6 +20,9 @@
 
 #include <SDL3/SDL.h>
 #include "celeste.h"
+#ifdef CELESTE_P8_SINTABLE
+#include "p8sin.h"
+#endif
 
   // I cant be bothered to put all function declarations in an appropiate place so ill just toss them all here:
 static void PRELUDE(void);
@@ -35,22 +38,201 @@ static void restart_room(void);
 #define false 0
 #define true 1
 
-static float clamp(float val, float a, float b);
-static float appr(float val, float target, float amount);
-static float sign(float v);
 static bool maybe(void);
 static bool solid_at(int x, int y, int w, int h);
 static bool ice_at(int x, int y, int w, int h);
 static bool tile_flag_at(int x, int y, int w, int h, int flag);
 static int tile_at(int x, int y);
-static bool spikes_at(float x, float y, int w, int h, float xspd, float yspd);
+static void build_room_masks(void);
 
 // Exported/imported functions.
+static struct Celeste_P8_backend backend;
 static Celeste_P8_cb_func_t Celeste_P8_call = NULL;
 
+// Adapters from the backend table to a variadic call function.
+static void call_music(int track, int fade, int mask) {
+    Celeste_P8_call(CELESTE_P8_MUSIC, track, fade, mask);
+}
+static void call_spr(int sprite, int x, int y, int cols, int rows, Celeste_P8_bool_t flipx, Celeste_P8_bool_t flipy) {
+    Celeste_P8_call(CELESTE_P8_SPR, sprite, x, y, cols, rows, flipx, flipy);
+}
+static Celeste_P8_bool_t call_btn(int b) {
+    return Celeste_P8_call(CELESTE_P8_BTN, b);
+}
+static void call_sfx(int id) {
+    Celeste_P8_call(CELESTE_P8_SFX, id);
+}
+static void call_pal(int a, int b) {
+    Celeste_P8_call(CELESTE_P8_PAL, a, b);
+}
+static void call_pal_reset(void) {
+    Celeste_P8_call(CELESTE_P8_PAL_RESET);
+}
+static void call_circfill(int x, int y, int r, int c) {
+    Celeste_P8_call(CELESTE_P8_CIRCFILL, x, y, r, c);
+}
+static void call_print(const char* str, int x, int y, int c) {
+    Celeste_P8_call(CELESTE_P8_PRINT, str, x, y, c);
+}
+static void call_rectfill(int x, int y, int x2, int y2, int c) {
+    Celeste_P8_call(CELESTE_P8_RECTFILL, x, y, x2, y2, c);
+}
+static void call_line(int x, int y, int x2, int y2, int c) {
+    Celeste_P8_call(CELESTE_P8_LINE, x, y, x2, y2, c);
+}
+static int call_mget(int x, int y) {
+    return Celeste_P8_call(CELESTE_P8_MGET, x, y);
+}
+static void call_camera(int x, int y) {
+    Celeste_P8_call(CELESTE_P8_CAMERA, x, y);
+}
+static Celeste_P8_bool_t call_fget(int t, int f) {
+    return Celeste_P8_call(CELESTE_P8_FGET, t, f);
+}
+static void call_map(int mx, int my, int tx, int ty, int mw, int mh, int mask) {
+    Celeste_P8_call(CELESTE_P8_MAP, mx, my, tx, ty, mw, mh, mask);
+}
+
+static const struct Celeste_P8_backend call_backend = {
+    call_music, call_spr, call_btn, call_sfx,
+    call_pal, call_pal_reset, call_circfill, call_print,
+    call_rectfill, call_line, call_mget, call_camera,
+    call_fget, call_map
+};
+
+// Drawing primitives that fill the draw list instead.
+static Celeste_P8_draw_list_t* draw_list = NULL;
+static struct Celeste_P8_backend installed; // The backend as set, without them.
+static bool draw_list_done = false;
+
+// A frame's list runs from the first call after the previous draw, so it
+// also holds the camera() calls made by screenshake during the update.
+static void draw_list_begin(void) {
+    if (draw_list_done) {
+        draw_list->count = draw_list->text_size = 0;
+        draw_list_done = false;
+    }
+}
+static void record(int type, int flags, int argc, const int* args) {
+    Celeste_P8_draw_cmd_t* cmd;
+    int i;
+
+    draw_list_begin();
+    if (draw_list->count++ >= CELESTE_P8_DRAW_LIST_SIZE) {
+        return;
+    }
+    cmd = &draw_list->cmds[draw_list->count - 1];
+    cmd->type = (unsigned char)type;
+    cmd->flags = (unsigned char)flags;
+    for (i = 0; i < argc; i++) {
+        cmd->args[i] = (short)args[i];
+    }
+}
+static void record_spr(int sprite, int x, int y, int cols, int rows, Celeste_P8_bool_t flipx, Celeste_P8_bool_t flipy) {
+    int args[] = { sprite, x, y, cols, rows };
+    record(CELESTE_P8_SPR, (flipx ? 1 : 0) | (flipy ? 2 : 0), 5, args);
+}
+static void record_pal(int a, int b) {
+    int args[] = { a, b };
+    record(CELESTE_P8_PAL, 0, 2, args);
+}
+static void record_pal_reset(void) {
+    record(CELESTE_P8_PAL_RESET, 0, 0, NULL);
+}
+static void record_circfill(int x, int y, int r, int c) {
+    int args[] = { x, y, r, c };
+    record(CELESTE_P8_CIRCFILL, 0, 4, args);
+}
+static void record_print(const char* str, int x, int y, int c) {
+    int size = (int)SDL_strlen(str) + 1;
+    int args[] = { 0, x, y, c };
+
+    draw_list_begin();
+    args[0] = draw_list->text_size;
+    draw_list->text_size += size;
+    if (draw_list->text_size > CELESTE_P8_DRAW_TEXT_SIZE) {
+        draw_list->count = CELESTE_P8_DRAW_LIST_SIZE + 1; // Out of text, report it as dropped.
+        return;
+    }
+    SDL_memcpy(draw_list->text + args[0], str, size);
+    record(CELESTE_P8_PRINT, 0, 4, args);
+}
+static void record_rectfill(int x, int y, int x2, int y2, int c) {
+    int args[] = { x, y, x2, y2, c };
+    record(CELESTE_P8_RECTFILL, 0, 5, args);
+}
+static void record_line(int x, int y, int x2, int y2, int c) {
+    int args[] = { x, y, x2, y2, c };
+    record(CELESTE_P8_LINE, 0, 5, args);
+}
+static void record_camera(int x, int y) {
+    int args[] = { x, y };
+    record(CELESTE_P8_CAMERA, 0, 2, args);
+}
+static void record_map(int mx, int my, int tx, int ty, int mw, int mh, int mask) {
+    int args[] = { mx, my, tx, ty, mw, mh, mask };
+    record(CELESTE_P8_MAP, 0, 7, args);
+}
+
+static void apply_backend(void) {
+    backend = installed;
+    if (draw_list) {
+        backend.spr = record_spr;
+        backend.pal = record_pal;
+        backend.pal_reset = record_pal_reset;
+        backend.circfill = record_circfill;
+        backend.print = record_print;
+        backend.rectfill = record_rectfill;
+        backend.line = record_line;
+        backend.camera = record_camera;
+        backend.map = record_map;
+    }
+}
+
 // Exported.
+void Celeste_P8_set_backend(const struct Celeste_P8_backend* b) {
+    installed = *b;
+    Celeste_P8_call = NULL;
+    apply_backend();
+}
 void Celeste_P8_set_call_func(Celeste_P8_cb_func_t func) {
+    installed = call_backend;
     Celeste_P8_call = func;
+    apply_backend();
+}
+void Celeste_P8_set_draw_list(Celeste_P8_draw_list_t* list) {
+    draw_list = list;
+    if (draw_list) {
+        draw_list->count = draw_list->text_size = 0;
+    }
+    apply_backend();
+}
+void Celeste_P8_run_draw_list(const Celeste_P8_draw_list_t* list, const struct Celeste_P8_backend* b) {
+    const Celeste_P8_draw_cmd_t* cmd = list->cmds;
+    const Celeste_P8_draw_cmd_t* end = cmd + SDL_min(list->count, CELESTE_P8_DRAW_LIST_SIZE);
+
+    if (!b) {
+        b = &installed;
+    }
+    for (; cmd < end; cmd++) {
+        const short* a = cmd->args;
+
+        switch (cmd->type) {
+            case CELESTE_P8_SPR:       b->spr(a[0], a[1], a[2], a[3], a[4], cmd->flags & 1, (cmd->flags >> 1) & 1); break;
+            case CELESTE_P8_PAL:       b->pal(a[0], a[1]); break;
+            case CELESTE_P8_PAL_RESET: b->pal_reset(); break;
+            case CELESTE_P8_CIRCFILL:  b->circfill(a[0], a[1], a[2], a[3]); break;
+            case CELESTE_P8_PRINT:     b->print(list->text + a[0], a[1], a[2], a[3]); break;
+            case CELESTE_P8_RECTFILL:  b->rectfill(a[0], a[1], a[2], a[3], a[4]); break;
+            case CELESTE_P8_LINE:      b->line(a[0], a[1], a[2], a[3], a[4]); break;
+            case CELESTE_P8_CAMERA:    b->camera(a[0], a[1]); break;
+            case CELESTE_P8_MAP:       b->map(a[0], a[1], a[2], a[3], a[4], a[5], a[6]); break;
+        }
+    }
+}
+static Celeste_P8_trace_func_t trace = NULL;
+void Celeste_P8_set_trace(Celeste_P8_trace_func_t func) {
+    trace = func;
 }
 static void pico8_srand(unsigned seed);
 void Celeste_P8_set_rndseed(unsigned seed) {
@@ -59,46 +241,46 @@ void Celeste_P8_set_rndseed(unsigned seed) {
 
 // PICO-8 functions.
 static inline void P8music(int track, int fade, int mask) {
-    Celeste_P8_call(CELESTE_P8_MUSIC, track, fade, mask);
+    backend.music(track, fade, mask);
 }
 static inline void P8spr(int sprite, int x, int y, int cols, int rows, bool flipx, bool flipy) {
-    Celeste_P8_call(CELESTE_P8_SPR, sprite, x, y, cols, rows, flipx, flipy);
+    backend.spr(sprite, x, y, cols, rows, flipx, flipy);
 }
 static inline bool P8btn(int b) {
-    return Celeste_P8_call(CELESTE_P8_BTN, b);
+    return backend.btn(b);
 }
 static inline void P8sfx(int id) {
-    Celeste_P8_call(CELESTE_P8_SFX, id);
+    backend.sfx(id);
 }
 static inline void P8pal(int a, int b) {
-    Celeste_P8_call(CELESTE_P8_PAL, a, b);
+    backend.pal(a, b);
 }
 static inline void P8pal_reset() {
-    Celeste_P8_call(CELESTE_P8_PAL_RESET);
+    backend.pal_reset();
 }
 static inline void P8circfill(int x, int y, int r, int c) {
-    Celeste_P8_call(CELESTE_P8_CIRCFILL, x, y, r, c);
+    backend.circfill(x, y, r, c);
 }
 static inline void P8rectfill(int x, int y, int x2, int y2, int c) {
-    Celeste_P8_call(CELESTE_P8_RECTFILL, x, y, x2, y2, c);
+    backend.rectfill(x, y, x2, y2, c);
 }
 static inline void P8print(const char* str, int x, int y, int c) {
-    Celeste_P8_call(CELESTE_P8_PRINT, str, x, y, c);
+    backend.print(str, x, y, c);
 }
 static inline void P8line(int x, int y, int x2, int y2, int c) {
-    Celeste_P8_call(CELESTE_P8_LINE, x, y, x2, y2, c);
+    backend.line(x, y, x2, y2, c);
 }
 static inline int P8mget(int x, int y) {
-    return Celeste_P8_call(CELESTE_P8_MGET, x, y);
+    return backend.mget(x, y);
 }
 static inline bool P8fget(int t, int f) {
-    return Celeste_P8_call(CELESTE_P8_FGET, t, f);
+    return backend.fget(t, f);
 }
 static inline void P8camera(int x, int y) {
-    Celeste_P8_call(CELESTE_P8_CAMERA, x, y);
+    backend.camera(x, y);
 }
 static inline void P8map(int mx, int my, int tx, int ty, int mw, int mh, int mask) {
-    Celeste_P8_call(CELESTE_P8_MAP, mx, my, tx, ty, mw, mh, mask);
+    backend.map(mx, my, tx, ty, mw, mh, mask);
 }
 // These values dont matter as set_rndseed should be called before init, as long as they arent both zero.
 static unsigned rnd_seed_lo = 0, rnd_seed_hi = 1;
@@ -140,16 +322,55 @@ inline double P8max(double left, double right) {
 inline double P8min(double left, double right) {
     return (left < right) ? left : right;
 }
-#define P8abs SDL_fabsf
-#define P8flr SDL_floorf
 #define fmodf SDL_fmodf
 #define sinf  SDL_sinf
 
+/* Object positions, speeds and sprites are PICO-8 numbers.  By default
+ * these are floats; with CELESTE_P8_FIXEDPOINT they are signed 16.16
+ * fixed point like on the PICO-8 itself, which avoids soft-float on
+ * targets without an FPU.  Arithmetic mixing them with other types has
+ * to go through the P8N_* macros below.
+ */
+#ifdef CELESTE_P8_FIXEDPOINT
+typedef Sint32 P8num;
+
+#define P8N(v)         ((P8num)((v) * 65536.0 + ((v) < 0 ? -0.5 : 0.5))) // Constants only.
+#define P8N_I(i)       ((P8num)(i) * 65536)
+#define P8N_F(f)       ((P8num)((f) * 65536.f))
+#define P8N_TOF(n)     ((float)(n) / 65536.f)
+#define P8N_TOI(n)     ((n) < 0 ? -(-(n) >> 16) : (n) >> 16) // Truncates like a float to int conversion.
+#define P8N_MUL(a, b)  ((P8num)(((Sint64)(a) * (b)) >> 16))
+#define P8N_DIV(a, b)  ((P8num)(((Sint64)(a) * 65536) / (b)))
+
+static inline P8num P8abs(P8num n) {
+    return n < 0 ? -n : n;
+}
+static inline P8num P8flr(P8num n) {
+    return n & ~0xffff;
+}
+static inline P8num P8modulo(P8num a, P8num b) {
+    return ((a % b) + b) % b;
+}
+#else
+typedef float P8num;
+
+#define P8N(v)         (v)
+#define P8N_I(i)       ((float)(i))
+#define P8N_F(f)       (f)
+#define P8N_TOF(n)     (n)
+#define P8N_TOI(n)     ((int)(n))
+#define P8N_MUL(a, b)  ((a) * (b))
+#define P8N_DIV(a, b)  ((a) / (b))
+
+#define P8abs SDL_fabsf
+#define P8flr SDL_floorf
+
 // https://github.com/lemon-sherbet/ccleste/issues/1
 static float P8modulo(float a, float b)
 {
     return fmodf(fmodf(a, b) + b, b);
 }
+#endif
 
 static float P8rnd(float max)
 {
@@ -157,10 +378,29 @@ static float P8rnd(float max)
     return (float)n / (1 << 16);
 }
 
+// Same sequence as P8rnd(), without leaving the P8num domain.
+static P8num P8rndn(P8num max)
+{
+#ifdef CELESTE_P8_FIXEDPOINT
+    return pico8_random(max);
+#else
+    return P8rnd(max);
+#endif
+}
+
+static P8num clamp(P8num val, P8num a, P8num b);
+static P8num appr(P8num val, P8num target, P8num amount);
+static P8num sign(P8num v);
+static bool spikes_at(P8num x, P8num y, int w, int h, P8num xspd, P8num yspd);
+
+#ifdef CELESTE_P8_SINTABLE
+#define P8sin P8sin_lut // See p8sin.h.
+#else
 static float P8sin(float x)
 {
     return -sinf(x * 6.2831853071796f); //https://pico-8.fandom.com/wiki/Math
 }
+#endif
 
 #define P8cos(x) (-P8sin((x)+0.25f)) //cos(x) = sin(x+pi/2)
 
@@ -176,14 +416,28 @@ static float P8sin(float x)
 //////////////
 typedef struct
 {
-    float x, y;
+    P8num x, y;
 } VEC;
 typedef struct
+{
+    float x, y;
+} VECF;
+typedef struct
 {
     int x, y;
 } VECI;
 
 static VECI room = { .x = 0, .y = 0 };
+
+// Collision masks of the current room, one bit per tile and one Uint16
+// per row, built by load_room() so hitbox queries never go through the
+// MGET and FGET callbacks.  They are derived from room, so they are not
+// part of the saved state.
+enum { SPIKES_UP, SPIKES_DOWN, SPIKES_RIGHT, SPIKES_LEFT, SPIKES_COUNT };
+static Uint16 room_flag_mask[8][16];
+static Uint16 room_spike_mask[SPIKES_COUNT][16];
+
+static Celeste_P8_stats_t stats;
 static int  freeze = 0;
 static int  shake = 0;
 static bool will_restart = false;
@@ -260,11 +514,15 @@ static void PRELUDE()
 
 void Celeste_P8_init() // Identifiers beginning with underscores are reserved in C.
 {
-    if (!Celeste_P8_call)
+    if (!installed.spr)
     {
-        SDL_Log("Warning: Celeste_P8_call is NULL.. have you called Celeste_P8_set_call_func()?");
+        SDL_Log("Warning: no backend.. have you called Celeste_P8_set_backend() or Celeste_P8_set_call_func()?");
     }
 
+#ifdef CELESTE_P8_SINTABLE
+    P8sin_init_table();
+#endif
+
     PRELUDE();
 
     title_screen();
@@ -337,7 +595,7 @@ typedef struct
 {
     bool active;
     float x, y, s, spd, off, c, h, t;
-    VEC spd2; // Used by dead particles, moved from spd.
+    VECF spd2; // Used by dead particles, moved from spd.
 } PARTICLE;
 
 static PARTICLE particles[25];
@@ -351,10 +609,10 @@ static void PRELUDE_initparticles()
     {
         particles[i].x = P8rnd(128);
         particles[i].y = P8rnd(128);
-        particles[i].s = 0 + P8flr(P8rnd(5) / 4);
+        particles[i].s = 0 + SDL_floorf(P8rnd(5) / 4);
         particles[i].spd = 0.25f + P8rnd(5);
         particles[i].off = P8rnd(1);
-        particles[i].c = 6 + P8flr(0.5 + P8rnd(1));
+        particles[i].c = 6 + SDL_floorf(0.5 + P8rnd(1));
     }
 }
 
@@ -372,6 +630,10 @@ typedef struct
 } HAIR;
 
 //OBJECT strucutre
+// destroy_object() shifts whole objects around and the state saves all of
+// them, so only what every object needs lives at the top.  Fields used by a
+// single type share a union, and the big per-type arrays (hair and the big
+// chest's particles) live outside of objects[] altogether.
 typedef struct
 {
     bool  active;
@@ -380,64 +642,116 @@ typedef struct
     //inherited
     OBJTYPE type;
     bool    collideable, solids;
-    float   spr;
+    P8num   spr;
     bool    flip_x, flip_y;
-    float   x, y;
+    P8num   x, y;
     HITBOX  hitbox;
     VEC     spd;
     VEC     rem;
 
-    // Player.
-    bool  p_jump, p_dash;
-    int   grace, jbuffer, djump, dash_time;
-    short dash_effect_time; // Can underflow in normal gameplay (after 18 minutes)
-    VEC   dash_target;
-    VEC   dash_accel;
-    float spr_off;
-    bool  was_on_ground;
-    HAIR  hair[5]; // Also player_spawn.
+    union
+    {
+        struct
+        {
+            bool  p_jump, p_dash;
+            int   grace, jbuffer, djump, dash_time;
+            short dash_effect_time; // Can underflow in normal gameplay (after 18 minutes)
+            VEC   dash_target;
+            VEC   dash_accel;
+            P8num spr_off;
+            bool  was_on_ground;
+        } player;
 
-    // Player_spawn.
-    int state, delay;
-    VEC target;
+        struct
+        {
+            int state, delay;
+            VEC target;
+        } player_spawn;
 
-    // Spring.
-    int hide_in, hide_for;
+        struct
+        {
+            int hide_in, hide_for, delay;
+        } spring;
 
-    // Balloon.
-    int   timer;
-    float offset, start;
+        struct
+        {
+            int   timer;
+            float offset;
+            P8num start;
+        } balloon;
 
-    // Fruit.
-    float off;
+        struct
+        {
+            int state, delay;
+        } fall_floor;
 
-    // Fly_fruit.
-    bool  fly;
-    float step;
-    int   sfx_delay;
+        struct
+        {
+            P8num start;
+            float off;
+        } fruit;
 
-    // Lifeup.
-    int   duration;
-    float flash;
+        struct
+        {
+            P8num start;
+            bool  fly;
+            float step;
+            int   sfx_delay;
+        } fly_fruit;
 
-    // Platform.
-    float last, dir;
+        struct
+        {
+            int timer;
+            P8num start;
+        } chest;
 
-    // Message.
-    const char* text;
-    float       index;
-    VECI        off2; //changed from off..
+        struct
+        {
+            int   duration;
+            float flash;
+        } lifeup;
 
-    // Big chest.
-    PARTICLE particles[50];
-    int      particle_count;
+        struct
+        {
+            P8num last, dir;
+        } platform;
 
-    // Flag.
-    int  score;
-    bool show;
+        struct
+        {
+            const char* text;
+            P8num       index, last;
+            VECI        off2; //changed from off..
+        } message;
+
+        struct
+        {
+            int state, timer;
+        } big_chest;
+
+        struct
+        {
+            int score;
+            bool show;
+        } flag;
+
+        struct
+        {
+            int delay;
+        } room_title;
+    } u;
 
 } OBJ;
 
+// Only the player and the player spawn have hair, and there is at most one
+// of each.
+static HAIR hair[2][5];
+
+#define OBJ_HAIR(o) hair[(o)->type == OBJ_PLAYER ? 0 : 1]
+
+// There is only one big chest in the game.
+static PARTICLE big_chest_particles[50];
+static int      big_chest_particle_count;
+
 // OBJ function declarations.
 #define when_Y(x) static void x(OBJ* this);
 #define when_N(x) enum { x = 0 }; //OBJTYPE_prop definition requires a constant value, and `static cost void* x = NULL` doesn't count
@@ -481,6 +795,28 @@ static const struct objprop OBJTYPE_prop[] =
 static OBJ objects[MAX_OBJECTS] = {
     {.active = false }
 };
+static short next_object_id = 0; // Saved with the objects so ids stay unique after a load.
+
+// Active slots of each object type, bit i standing for objects[i], so
+// walking the set bits from the bottom visits them in slot order like
+// a scan of objects[] would.  Kept up to date by init_object(),
+// destroy_object() and load_room(); derived, so not part of the state.
+static Uint32 type_slots[OBJTYPE_COUNT];
+SDL_COMPILE_TIME_ASSERT(type_slots, MAX_OBJECTS <= 32);
+
+static void rebuild_type_slots(void)
+{
+    int i;
+
+    SDL_memset(type_slots, 0, sizeof type_slots);
+    for (i = 0; i < MAX_OBJECTS; i++)
+    {
+        if (objects[i].active)
+        {
+            type_slots[objects[i].type] |= 1u << i;
+        }
+    }
+}
 
 static void create_hair(OBJ* obj);
 static void set_hair_color(int c);
@@ -489,47 +825,56 @@ static void unset_hair_color(void);
 static void kill_player(OBJ* obj);
 static void break_fall_floor(OBJ* obj);
 static void draw_time(float x, float y);
-static OBJ* init_object(OBJTYPE type, float x, float y);
+static OBJ* init_object(OBJTYPE type, P8num x, P8num y);
 static void destroy_object(OBJ* obj);
 static void draw_object(OBJ* obj);
 
 //OBJECT FUNCTIONS MOVED HERE
 
-static bool OBJ_is_solid(OBJ* obj, float ox, float oy);
-static bool OBJ_is_ice(OBJ* obj, float ox, float oy);
-static OBJ* OBJ_collide(OBJ* obj, OBJTYPE type, float ox, float oy);
-static bool OBJ_check(OBJ* obj, OBJTYPE type, float ox, float oy);
-static void OBJ_move(OBJ* obj, float ox, float oy);
-static void OBJ_move_x(OBJ* obj, float amount, float start);
-static void OBJ_move_y(OBJ* obj, float amount);
+static bool OBJ_is_solid(OBJ* obj, int ox, int oy);
+static bool OBJ_is_ice(OBJ* obj, int ox, int oy);
+static OBJ* OBJ_collide(OBJ* obj, OBJTYPE type, int ox, int oy);
+static bool OBJ_check(OBJ* obj, OBJTYPE type, int ox, int oy);
+static void OBJ_move(OBJ* obj, P8num ox, P8num oy);
+static void OBJ_move_x(OBJ* obj, P8num amount, int start);
+static void OBJ_move_y(OBJ* obj, P8num amount);
 
-static bool OBJ_is_solid(OBJ* obj, float ox, float oy)
+// Offsets are always whole pixels, so they are passed as int.
+static bool OBJ_is_solid(OBJ* obj, int ox, int oy)
 {
     if (oy > 0 && !OBJ_check(obj, OBJ_PLATFORM, ox, 0) && OBJ_check(obj, OBJ_PLATFORM, ox, oy))
     {
         return true;
     }
-    return solid_at(obj->x + obj->hitbox.x + ox, obj->y + obj->hitbox.y + oy, obj->hitbox.w, obj->hitbox.h)
+    return solid_at(P8N_TOI(obj->x + P8N_I(obj->hitbox.x) + P8N_I(ox)), P8N_TOI(obj->y + P8N_I(obj->hitbox.y) + P8N_I(oy)), obj->hitbox.w, obj->hitbox.h)
         || OBJ_check(obj, OBJ_FALL_FLOOR, ox, oy)
         || OBJ_check(obj, OBJ_FAKE_WALL, ox, oy);
 }
 
-static bool OBJ_is_ice(OBJ* obj, float ox, float oy)
+static bool OBJ_is_ice(OBJ* obj, int ox, int oy)
 {
-    return ice_at(obj->x + obj->hitbox.x + ox, obj->y + obj->hitbox.y + oy, obj->hitbox.w, obj->hitbox.h);
+    return ice_at(P8N_TOI(obj->x + P8N_I(obj->hitbox.x) + P8N_I(ox)), P8N_TOI(obj->y + P8N_I(obj->hitbox.y) + P8N_I(oy)), obj->hitbox.w, obj->hitbox.h);
 }
 
-static OBJ* OBJ_collide(OBJ* obj, OBJTYPE type, float ox, float oy)
+static OBJ* OBJ_collide(OBJ* obj, OBJTYPE type, int ox, int oy)
 {
-    int i;
-    for (i = 0; i < MAX_OBJECTS; i++)
+    Uint32 slots;
+    int    i;
+
+    stats.obj_queries++;
+    for (i = 0, slots = type_slots[type]; slots; i++, slots >>= 1)
     {
         OBJ* other = &objects[i];
-        if (other->active && other->type == type && other != obj && other->collideable &&
-            other->x + other->hitbox.x + other->hitbox.w > obj->x + obj->hitbox.x + ox &&
-            other->y + other->hitbox.y + other->hitbox.h > obj->y + obj->hitbox.y + oy &&
-            other->x + other->hitbox.x < obj->x + obj->hitbox.x + obj->hitbox.w + ox &&
-            other->y + other->hitbox.y < obj->y + obj->hitbox.y + obj->hitbox.h + oy)
+        if (!(slots & 1))
+        {
+            continue;
+        }
+        stats.obj_candidates++;
+        if (other != obj && other->collideable &&
+            other->x + P8N_I(other->hitbox.x) + P8N_I(other->hitbox.w) > obj->x + P8N_I(obj->hitbox.x) + P8N_I(ox) &&
+            other->y + P8N_I(other->hitbox.y) + P8N_I(other->hitbox.h) > obj->y + P8N_I(obj->hitbox.y) + P8N_I(oy) &&
+            other->x + P8N_I(other->hitbox.x) < obj->x + P8N_I(obj->hitbox.x) + P8N_I(obj->hitbox.w) + P8N_I(ox) &&
+            other->y + P8N_I(other->hitbox.y) < obj->y + P8N_I(obj->hitbox.y) + P8N_I(obj->hitbox.h) + P8N_I(oy))
         {
             return other;
         }
@@ -537,38 +882,38 @@ static OBJ* OBJ_collide(OBJ* obj, OBJTYPE type, float ox, float oy)
     return NULL;
 }
 
-static bool OBJ_check(OBJ* obj, OBJTYPE type, float ox, float oy)
+static bool OBJ_check(OBJ* obj, OBJTYPE type, int ox, int oy)
 {
     return OBJ_collide(obj, type, ox, oy) != NULL;
 }
 
-static void OBJ_move(OBJ* obj, float ox, float oy)
+static void OBJ_move(OBJ* obj, P8num ox, P8num oy)
 {
-    float amount;
+    P8num amount;
     // [x] get move amount
     obj->rem.x += ox;
-    amount = P8flr(obj->rem.x + 0.5);
+    amount = P8flr(obj->rem.x + P8N(0.5));
     obj->rem.x -= amount;
     OBJ_move_x(obj, amount, 0);
 
     // [y] get move amount
     obj->rem.y += oy;
-    amount = P8flr(obj->rem.y + 0.5);
+    amount = P8flr(obj->rem.y + P8N(0.5));
     obj->rem.y -= amount;
     OBJ_move_y(obj, amount);
 }
 
-static void OBJ_move_x(OBJ* obj, float amount, float start)
+static void OBJ_move_x(OBJ* obj, P8num amount, int start)
 {
     if (obj->solids)
     {
-        float step = sign(amount);
-        float i;
-        for (i = start; i <= P8abs(amount); i += 1)
+        int step = P8N_TOI(sign(amount));
+        int i;
+        for (i = start; P8N_I(i) <= P8abs(amount); i += 1)
         {
             if (!OBJ_is_solid(obj, step, 0))
             {
-                obj->x += step;
+                obj->x += P8N_I(step);
             }
             else
             {
@@ -584,17 +929,17 @@ static void OBJ_move_x(OBJ* obj, float amount, float start)
     }
 }
 
-static void OBJ_move_y(OBJ* obj, float amount)
+static void OBJ_move_y(OBJ* obj, P8num amount)
 {
     if (obj->solids)
     {
-        float step = sign(amount);
-        int   i;
-        for (i = 0; i <= P8abs(amount); i++)
+        int step = P8N_TOI(sign(amount));
+        int i;
+        for (i = 0; P8N_I(i) <= P8abs(amount); i++)
         {
             if (!OBJ_is_solid(obj, 0, step))
             {
-                obj->y += step;
+                obj->y += P8N_I(step);
             }
             else
             {
@@ -615,18 +960,18 @@ static void OBJ_move_y(OBJ* obj, float amount)
 ///////////////////
 static void PLAYER_init(OBJ* this)
 {
-    this->p_jump = false;
-    this->p_dash = false;
-    this->grace = 0;
-    this->jbuffer = 0;
-    this->djump = max_djump;
-    this->dash_time = 0;
-    this->dash_effect_time = 0;
-    this->dash_target = (VEC){ .x = 0,.y = 0 };
-    this->dash_accel = (VEC){ .x = 0,.y = 0 };
+    this->u.player.p_jump = false;
+    this->u.player.p_dash = false;
+    this->u.player.grace = 0;
+    this->u.player.jbuffer = 0;
+    this->u.player.djump = max_djump;
+    this->u.player.dash_time = 0;
+    this->u.player.dash_effect_time = 0;
+    this->u.player.dash_target = (VEC){ .x = 0,.y = 0 };
+    this->u.player.dash_accel = (VEC){ .x = 0,.y = 0 };
     this->hitbox = (HITBOX){ .x = 1,.y = 3,.w = 6,.h = 5 };
-    this->spr_off = 0;
-    this->was_on_ground = false;
+    this->u.player.spr_off = 0;
+    this->u.player.was_on_ground = false;
     create_hair(this);
 }
 
@@ -653,13 +998,13 @@ static void PLAYER_update(OBJ* this)
     }
 
     // Spikes collide.
-    if (spikes_at(this->x + this->hitbox.x, this->y + this->hitbox.y, this->hitbox.w, this->hitbox.h, this->spd.x, this->spd.y))
+    if (spikes_at(this->x + P8N_I(this->hitbox.x), this->y + P8N_I(this->hitbox.y), this->hitbox.w, this->hitbox.h, this->spd.x, this->spd.y))
     {
         do_kill_player = true;
     }
 
     //Bottom death.
-    if (this->y > 128)
+    if (this->y > P8N_I(128))
     {
         do_kill_player = true;
     }
@@ -675,78 +1020,78 @@ static void PLAYER_update(OBJ* this)
     on_ice = OBJ_is_ice(this, 0, 1);
 
     // smoke particles
-    if (on_ground && !this->was_on_ground)
+    if (on_ground && !this->u.player.was_on_ground)
     {
-        init_object(OBJ_SMOKE, this->x, this->y + 4);
+        init_object(OBJ_SMOKE, this->x, this->y + P8N_I(4));
     }
 
-    jump = P8btn(k_jump) && !this->p_jump;
-    this->p_jump = P8btn(k_jump);
+    jump = P8btn(k_jump) && !this->u.player.p_jump;
+    this->u.player.p_jump = P8btn(k_jump);
     if ((jump))
     {
-        this->jbuffer = 4;
+        this->u.player.jbuffer = 4;
     }
-    else if (this->jbuffer > 0)
+    else if (this->u.player.jbuffer > 0)
     {
-        this->jbuffer -= 1;
+        this->u.player.jbuffer -= 1;
     }
 
-    dash = P8btn(k_dash) && !this->p_dash;
-    this->p_dash = P8btn(k_dash);
+    dash = P8btn(k_dash) && !this->u.player.p_dash;
+    this->u.player.p_dash = P8btn(k_dash);
 
     if (on_ground)
     {
-        this->grace = 6;
-        if (this->djump < max_djump)
+        this->u.player.grace = 6;
+        if (this->u.player.djump < max_djump)
         {
             psfx(54);
-            this->djump = max_djump;
+            this->u.player.djump = max_djump;
         }
     }
-    else if (this->grace > 0)
+    else if (this->u.player.grace > 0)
     {
-        this->grace -= 1;
+        this->u.player.grace -= 1;
     }
 
-    this->dash_effect_time -= 1;
-    if (this->dash_time > 0)
+    this->u.player.dash_effect_time -= 1;
+    if (this->u.player.dash_time > 0)
     {
         init_object(OBJ_SMOKE, this->x, this->y);
-        this->dash_time -= 1;
-        this->spd.x = appr(this->spd.x, this->dash_target.x, this->dash_accel.x);
-        this->spd.y = appr(this->spd.y, this->dash_target.y, this->dash_accel.y);
+        this->u.player.dash_time -= 1;
+        this->spd.x = appr(this->spd.x, this->u.player.dash_target.x, this->u.player.dash_accel.x);
+        this->spd.y = appr(this->spd.y, this->u.player.dash_target.y, this->u.player.dash_accel.y);
     }
     else
     {
         // Move.
         int   maxrun = 1;
-        float accel = 0.6;
-        float d_full;
-        float d_half;
-        float maxfall;
-        float gravity;
+        P8num accel = P8N(0.6);
+        P8num d_full;
+        P8num d_half;
+        P8num maxfall;
+        P8num gravity;
 
         if (!on_ground)
         {
-            accel = 0.4;
+            accel = P8N(0.4);
         }
         else if (on_ice)
         {
-            accel = 0.05;
+            accel = P8N(0.05);
             if (input == (this->flip_x ? -1 : 1))
             {
-                accel = 0.05;
+                accel = P8N(0.05);
             }
         }
 
-        if (P8abs(this->spd.x) > maxrun)
+        if (P8abs(this->spd.x) > P8N_I(maxrun))
         {
-            float deccel = 0.15;
+            P8num deccel = P8N(0.15);
             this->spd.x = appr(this->spd.x, sign(this->spd.x) * maxrun, deccel);
         }
         else
         {
-            this->spd.x = appr(this->spd.x, input * maxrun, accel);
+            this->spd.x = appr(this->spd.x, P8N_I(input * maxrun), accel);
         }
 
         // Facing.
@@ -756,21 +1101,21 @@ static void PLAYER_update(OBJ* this)
         }
 
         // Gravity.
-        maxfall = 2;
-        gravity = 0.21;
+        maxfall = P8N_I(2);
+        gravity = P8N(0.21);
 
-        if (P8abs(this->spd.y) <= 0.15)
+        if (P8abs(this->spd.y) <= P8N(0.15))
         {
-            gravity *= 0.5;
+            gravity = P8N_MUL(gravity, P8N(0.5));
         }
 
         // Wall slide.
         if (input != 0 && OBJ_is_solid(this, input, 0) && !OBJ_is_ice(this, input, 0))
         {
-            maxfall = 0.4;
-            if (P8rnd(10) < 2)
+            maxfall = P8N(0.4);
+            if (P8rndn(P8N_I(10)) < P8N_I(2))
             {
-                init_object(OBJ_SMOKE, this->x + input * 6, this->y);
+                init_object(OBJ_SMOKE, this->x + P8N_I(input * 6), this->y);
             }
         }
 
@@ -780,16 +1125,16 @@ static void PLAYER_update(OBJ* this)
         }
 
         // Jump.
-        if (this->jbuffer > 0)
+        if (this->u.player.jbuffer > 0)
         {
-            if (this->grace > 0)
+            if (this->u.player.grace > 0)
             {
                 // Normal jump.
                 psfx(1);
-                this->jbuffer = 0;
-                this->grace = 0;
-                this->spd.y = -2;
-                init_object(OBJ_SMOKE, this->x, this->y + 4);
+                this->u.player.jbuffer = 0;
+                this->u.player.grace = 0;
+                this->spd.y = P8N_I(-2);
+                init_object(OBJ_SMOKE, this->x, this->y + P8N_I(4));
             }
             else
             {
@@ -798,29 +1143,29 @@ static void PLAYER_update(OBJ* this)
                 if (wall_dir != 0)
                 {
                     psfx(2);
-                    this->jbuffer = 0;
-                    this->spd.y = -2;
-                    this->spd.x = -wall_dir * (maxrun + 1);
+                    this->u.player.jbuffer = 0;
+                    this->spd.y = P8N_I(-2);
+                    this->spd.x = P8N_I(-wall_dir * (maxrun + 1));
                     if (!OBJ_is_ice(this, wall_dir * 3, 0))
                     {
-                        init_object(OBJ_SMOKE, this->x + wall_dir * 6, this->y);
+                        init_object(OBJ_SMOKE, this->x + P8N_I(wall_dir * 6), this->y);
                     }
                 }
             }
         }
 
         // Dash.
-        d_full = 5;
-        d_half = d_full * 0.70710678118;
+        d_full = P8N_I(5);
+        d_half = P8N_MUL(d_full, P8N(0.70710678118));
 
-        if (this->djump > 0 && dash)
+        if (this->u.player.djump > 0 && dash)
         {
             int v_input;
             init_object(OBJ_SMOKE, this->x, this->y);
-            this->djump -= 1;
-            this->dash_time = 4;
+            this->u.player.djump -= 1;
+            this->u.player.dash_time = 4;
             has_dashed = true;
-            this->dash_effect_time = 10;
+            this->u.player.dash_effect_time = 10;
             v_input = (P8btn(k_up) ? -1 : (P8btn(k_down) ? 1 : 0));
             if (input != 0)
             {
@@ -842,34 +1187,34 @@ static void PLAYER_update(OBJ* this)
             }
             else
             {
-                this->spd.x = (this->flip_x ? -1 : 1);
+                this->spd.x = P8N_I(this->flip_x ? -1 : 1);
                 this->spd.y = 0;
             }
 
             psfx(3);
             freeze = 2;
             shake = 6;
-            this->dash_target.x = 2 * sign(this->spd.x);
-            this->dash_target.y = 2 * sign(this->spd.y);
-            this->dash_accel.x = 1.5;
-            this->dash_accel.y = 1.5;
+            this->u.player.dash_target.x = 2 * sign(this->spd.x);
+            this->u.player.dash_target.y = 2 * sign(this->spd.y);
+            this->u.player.dash_accel.x = P8N(1.5);
+            this->u.player.dash_accel.y = P8N(1.5);
 
             if (this->spd.y < 0)
             {
-                this->dash_target.y *= .75;
+                this->u.player.dash_target.y = P8N_MUL(this->u.player.dash_target.y, P8N(.75));
             }
 
             if (this->spd.y != 0)
             {
-                this->dash_accel.x *= 0.70710678118f;
+                this->u.player.dash_accel.x = P8N_MUL(this->u.player.dash_accel.x, P8N(0.70710678118f));
             }
 
             if (this->spd.x != 0)
             {
-                this->dash_accel.y *= 0.70710678118f;
+                this->u.player.dash_accel.y = P8N_MUL(this->u.player.dash_accel.y, P8N(0.70710678118f));
             }
         }
-        else if (dash && this->djump <= 0)
+        else if (dash && this->u.player.djump <= 0)
         {
             psfx(9);
             init_object(OBJ_SMOKE, this->x, this->y);
@@ -877,57 +1222,57 @@ static void PLAYER_update(OBJ* this)
     }
 
     // Animation.
-    this->spr_off += 0.25;
+    this->u.player.spr_off += P8N(0.25);
     if (!on_ground)
     {
         if (OBJ_is_solid(this, input, 0))
         {
-            this->spr = 5;
+            this->spr = P8N_I(5);
         }
         else
         {
-            this->spr = 3;
+            this->spr = P8N_I(3);
         }
     }
     else if (P8btn(k_down))
     {
-        this->spr = 6;
+        this->spr = P8N_I(6);
     }
     else if (P8btn(k_up))
     {
-        this->spr = 7;
+        this->spr = P8N_I(7);
     }
     else if ((this->spd.x == 0) || (!P8btn(k_left) && !P8btn(k_right)))
     {
-        this->spr = 1;
+        this->spr = P8N_I(1);
     }
     else
     {
-        this->spr = 1 + ((int)this->spr_off) % 4;
+        this->spr = P8N_I(1 + P8N_TOI(this->u.player.spr_off) % 4);
     }
 
     // Next level.
-    if (this->y < -4 && level_index() < 30)
+    if (this->y < P8N_I(-4) && level_index() < 30)
     {
         next_room();
     }
 
     // Was on the ground.
-    this->was_on_ground = on_ground;
+    this->u.player.was_on_ground = on_ground;
 }
 
 static void PLAYER_draw(OBJ* this)
 {
     // Clamp in screen.
-    if (this->x < -1 || this->x>121)
+    if (this->x < P8N_I(-1) || this->x > P8N_I(121))
     {
-        this->x = clamp(this->x, -1, 121);
+        this->x = clamp(this->x, P8N_I(-1), P8N_I(121));
         this->spd.x = 0;
     }
 
-    set_hair_color(this->djump);
+    set_hair_color(this->u.player.djump);
     draw_hair(this, this->flip_x ? -1 : 1);
-    P8spr(this->spr, this->x, this->y, 1, 1, this->flip_x, this->flip_y);
+    P8spr(P8N_TOI(this->spr), P8N_TOI(this->x), P8N_TOI(this->y), 1, 1, this->flip_x, this->flip_y);
     unset_hair_color();
 }
 
@@ -944,9 +1289,9 @@ void create_hair(OBJ* obj)
     int i;
     for (i = 0; i <= 4; i++)
     {
-        obj->hair[i] = (HAIR){
-            .x = obj->x,
-            .y = obj->y,
+        OBJ_HAIR(obj)[i] = (HAIR){
+            .x = P8N_TOF(obj->x),
+            .y = P8N_TOF(obj->y),
             .size = P8max(1,P8min(2,3 - i)),
             .isLast = i == 4
         };
@@ -955,18 +1300,18 @@ void create_hair(OBJ* obj)
 
 static void set_hair_color(int djump)
 {
-    P8pal(8, (djump == 1 ? 8 : (djump == 2 ? (7 + P8flr(((int)(((float)frames) / 3.0)) % 2) * 4) : 12)));
+    P8pal(8, (djump == 1 ? 8 : (djump == 2 ? (7 + SDL_floorf(((int)(((float)frames) / 3.0)) % 2) * 4) : 12)));
 }
 
 static void draw_hair(OBJ* obj, int facing)
 {
-    float last_x = obj->x + 4 - facing * 2;
-    float last_y = obj->y + (P8btn(k_down) ? 4 : 3);
+    float last_x = P8N_TOF(obj->x) + 4 - facing * 2;
+    float last_y = P8N_TOF(obj->y) + (P8btn(k_down) ? 4 : 3);
     HAIR* h;
     int i = 0;
     do
     {
-        h = &obj->hair[i++];
+        h = &OBJ_HAIR(obj)[i++];
         h->x += (last_x - h->x) / 1.5;
         h->y += (last_y + 0.5 - h->y) / 1.5;
         P8circfill(h->x, h->y, h->size, 8);
@@ -984,55 +1329,55 @@ static void unset_hair_color()
 static void PLAYER_SPAWN_init(OBJ* this)
 {
     P8sfx(4);
-    this->spr = 3;
-    this->target.x = this->x;
-    this->target.y = this->y;
-    this->y = 128;
-    this->spd.y = -4;
-    this->state = 0;
-    this->delay = 0;
+    this->spr = P8N_I(3);
+    this->u.player_spawn.target.x = this->x;
+    this->u.player_spawn.target.y = this->y;
+    this->y = P8N_I(128);
+    this->spd.y = P8N_I(-4);
+    this->u.player_spawn.state = 0;
+    this->u.player_spawn.delay = 0;
     this->solids = false;
     create_hair(this);
 }
 static void PLAYER_SPAWN_update(OBJ* this)
 {
     // Jumping up.
-    if (this->state == 0)
+    if (this->u.player_spawn.state == 0)
     {
-        if (this->y < this->target.y + 16)
+        if (this->y < this->u.player_spawn.target.y + P8N_I(16))
         {
-            this->state = 1;
-            this->delay = 3;
+            this->u.player_spawn.state = 1;
+            this->u.player_spawn.delay = 3;
         }
         // Falling.
     }
-    else if (this->state == 1)
+    else if (this->u.player_spawn.state == 1)
     {
-        this->spd.y += 0.5;
-        if (this->spd.y > 0 && this->delay > 0)
+        this->spd.y += P8N(0.5);
+        if (this->spd.y > 0 && this->u.player_spawn.delay > 0)
         {
             this->spd.y = 0;
-            this->delay -= 1;
+            this->u.player_spawn.delay -= 1;
         }
-        if (this->spd.y > 0 && this->y > this->target.y)
+        if (this->spd.y > 0 && this->y > this->u.player_spawn.target.y)
         {
-            this->y = this->target.y;
+            this->y = this->u.player_spawn.target.y;
             this->spd.x = this->spd.y = 0;
-            this->state = 2;
-            this->delay = 5;
+            this->u.player_spawn.state = 2;
+            this->u.player_spawn.delay = 5;
             shake = 5;
-            init_object(OBJ_SMOKE, this->x, this->y + 4);
+            init_object(OBJ_SMOKE, this->x, this->y + P8N_I(4));
             P8sfx(5);
         }
         // landing
     }
-    else if (this->state == 2)
+    else if (this->u.player_spawn.state == 2)
     {
-        this->delay -= 1;
-        this->spr = 6;
-        if (this->delay < 0)
+        this->u.player_spawn.delay -= 1;
+        this->spr = P8N_I(6);
+        if (this->u.player_spawn.delay < 0)
         {
-            float x = this->x, y = this->y;
+            P8num x = this->x, y = this->y;
             destroy_object(this);
             init_object(OBJ_PLAYER, x, y);
         }
@@ -1043,40 +1388,40 @@ static void PLAYER_SPAWN_draw(OBJ* this)
 {
     set_hair_color(max_djump);
     draw_hair(this, 1);
-    P8spr(this->spr, this->x, this->y, 1, 1, this->flip_x, this->flip_y);
+    P8spr(P8N_TOI(this->spr), P8N_TOI(this->x), P8N_TOI(this->y), 1, 1, this->flip_x, this->flip_y);
     unset_hair_color();
 }
 
 // Spring.
 static void SPRING_init(OBJ* this)
 {
-    this->hide_in = 0;
-    this->hide_for = 0;
+    this->u.spring.hide_in = 0;
+    this->u.spring.hide_for = 0;
 }
 static void SPRING_update(OBJ* this)
 {
-    if (this->hide_for > 0)
+    if (this->u.spring.hide_for > 0)
     {
-        this->hide_for -= 1;
-        if (this->hide_for <= 0)
+        this->u.spring.hide_for -= 1;
+        if (this->u.spring.hide_for <= 0)
         {
-            this->spr = 18;
-            this->delay = 0;
+            this->spr = P8N_I(18);
+            this->u.spring.delay = 0;
         }
     }
-    else if (this->spr == 18)
+    else if (this->spr == P8N_I(18))
     {
         OBJ* hit = OBJ_collide(this, OBJ_PLAYER, 0, 0);
         if (hit != NULL && hit->spd.y >= 0)
         {
             OBJ* below;
 
-            this->spr = 19;
-            hit->y = this->y - 4;
-            hit->spd.x *= 0.2;
-            hit->spd.y = -3;
-            hit->djump = max_djump;
-            this->delay = 10;
+            this->spr = P8N_I(19);
+            hit->y = this->y - P8N_I(4);
+            hit->spd.x = P8N_MUL(hit->spd.x, P8N(0.2));
+            hit->spd.y = P8N_I(-3);
+            hit->u.player.djump = max_djump;
+            this->u.spring.delay = 10;
             init_object(OBJ_SMOKE, this->x, this->y);
 
             // breakable below us
@@ -1089,22 +1434,22 @@ static void SPRING_update(OBJ* this)
             psfx(8);
         }
     }
-    else if (this->delay > 0)
+    else if (this->u.spring.delay > 0)
     {
-        this->delay -= 1;
-        if (this->delay <= 0)
+        this->u.spring.delay -= 1;
+        if (this->u.spring.delay <= 0)
         {
-            this->spr = 18;
+            this->spr = P8N_I(18);
         }
     }
 
     // Begin hiding.
-    if (this->hide_in > 0)
+    if (this->u.spring.hide_in > 0)
     {
-        this->hide_in -= 1;
-        if (this->hide_in <= 0)
+        this->u.spring.hide_in -= 1;
+        if (this->u.spring.hide_in <= 0)
         {
-            this->hide_for = 60;
+            this->u.spring.hide_for = 60;
             this->spr = 0;
         }
     }
@@ -1112,71 +1457,71 @@ static void SPRING_update(OBJ* this)
 
 static void break_spring(OBJ* obj)
 {
-    obj->hide_in = 15;
+    obj->u.spring.hide_in = 15;
 }
 
 // Balloon.
 static void BALLOON_init(OBJ* this)
 {
-    this->offset = P8rnd(1);
-    this->start = this->y;
-    this->timer = 0;
+    this->u.balloon.offset = P8rnd(1);
+    this->u.balloon.start = this->y;
+    this->u.balloon.timer = 0;
     this->hitbox = (HITBOX){ .x = -1,.y = -1,.w = 10,.h = 10 };
 }
 
 static void BALLOON_update(OBJ* this)
 {
-    if (this->spr == 22)
+    if (this->spr == P8N_I(22))
     {
         OBJ* hit;
-        this->offset += 0.01;
+        this->u.balloon.offset += 0.01;
 #ifdef CELESTE_P8_HACKED_BALLOONS
         // Hacked balloons: constant y coord and hitbox. for TASes.
         this->hitbox = (HITBOX){ .x = -1,.y = -3,.w = 10,.h = 14 };
 #else
-        this->y = this->start + P8sin(this->offset) * 2;
+        this->y = this->u.balloon.start + P8N_F(P8sin(this->u.balloon.offset) * 2);
 #endif
         hit = OBJ_collide(this, OBJ_PLAYER, 0, 0);
-        if (hit != NULL && hit->djump < max_djump)
+        if (hit != NULL && hit->u.player.djump < max_djump)
         {
             psfx(6);
             init_object(OBJ_SMOKE, this->x, this->y);
-            hit->djump = max_djump;
+            hit->u.player.djump = max_djump;
             this->spr = 0;
-            this->timer = 60;
+            this->u.balloon.timer = 60;
         }
     }
-    else if (this->timer > 0)
+    else if (this->u.balloon.timer > 0)
     {
-        this->timer -= 1;
+        this->u.balloon.timer -= 1;
     }
     else
     {
         psfx(7);
         init_object(OBJ_SMOKE, this->x, this->y);
-        this->spr = 22;
+        this->spr = P8N_I(22);
     }
 }
 
 static void BALLOON_draw(OBJ* this)
 {
-    if (this->spr == 22)
+    if (this->spr == P8N_I(22))
     {
-        P8spr(13 + (int)(this->offset * 8) % 3, this->x, this->y + 6, 1, 1, false, false);
-        P8spr(this->spr, this->x, this->y, 1, 1, false, false);
+        P8spr(13 + (int)(this->u.balloon.offset * 8) % 3, P8N_TOI(this->x), P8N_TOI(this->y + P8N_I(6)), 1, 1, false, false);
+        P8spr(P8N_TOI(this->spr), P8N_TOI(this->x), P8N_TOI(this->y), 1, 1, false, false);
     }
 }
 
 // Fall_floor.
 static void FALL_FLOOR_init(OBJ* this)
 {
-    this->state = 0;
+    this->u.fall_floor.state = 0;
 }
 
 static void FALL_FLOOR_update(OBJ* this)
 {
     // idling
-    if (this->state == 0)
+    if (this->u.fall_floor.state == 0)
     {
         if (OBJ_check(this, OBJ_PLAYER, 0, -1) || OBJ_check(this, OBJ_PLAYER, -1, 0) || OBJ_check(this, OBJ_PLAYER, 1, 0))
         {
@@ -1184,24 +1529,24 @@ static void FALL_FLOOR_update(OBJ* this)
         }
         // Shaking.
     }
-    else if (this->state == 1)
+    else if (this->u.fall_floor.state == 1)
     {
-        this->delay -= 1;
-        if (this->delay <= 0)
+        this->u.fall_floor.delay -= 1;
+        if (this->u.fall_floor.delay <= 0)
         {
-            this->state = 2;
-            this->delay = 60; //how long it hides for
+            this->u.fall_floor.state = 2;
+            this->u.fall_floor.delay = 60; //how long it hides for
             this->collideable = false;
         }
         // Invisible, waiting to reset.
     }
-    else if (this->state == 2)
+    else if (this->u.fall_floor.state == 2)
     {
-        this->delay -= 1;
-        if (this->delay <= 0 && !OBJ_check(this, OBJ_PLAYER, 0, 0))
+        this->u.fall_floor.delay -= 1;
+        if (this->u.fall_floor.delay <= 0 && !OBJ_check(this, OBJ_PLAYER, 0, 0))
         {
             psfx(7);
-            this->state = 0;
+            this->u.fall_floor.state = 0;
             this->collideable = true;
             init_object(OBJ_SMOKE, this->x, this->y);
         }
@@ -1209,26 +1554,26 @@ static void FALL_FLOOR_update(OBJ* this)
 }
 static void FALL_FLOOR_draw(OBJ* this)
 {
-    if (this->state != 2)
+    if (this->u.fall_floor.state != 2)
     {
-        if (this->state != 1) {
-            P8spr(23, this->x, this->y, 1, 1, false, false);
+        if (this->u.fall_floor.state != 1) {
+            P8spr(23, P8N_TOI(this->x), P8N_TOI(this->y), 1, 1, false, false);
         }
         else
         {
-            P8spr(23 + (15 - this->delay) / 5, this->x, this->y, 1, 1, false, false);
+            P8spr(23 + (15 - this->u.fall_floor.delay) / 5, P8N_TOI(this->x), P8N_TOI(this->y), 1, 1, false, false);
         }
     }
 }
 
 static void break_fall_floor(OBJ* obj)
 {
-    if (obj->state == 0)
+    if (obj->u.fall_floor.state == 0)
     {
         OBJ* hit;
         psfx(15);
-        obj->state = 1;
-        obj->delay = 15;        // How long until it falls.
+        obj->u.fall_floor.state = 1;
+        obj->u.fall_floor.delay = 15;        // How long until it falls.
         init_object(OBJ_SMOKE, obj->x, obj->y);
         hit = OBJ_collide(obj, OBJ_SPRING, 0, -1);
         if (hit != NULL)
@@ -1240,11 +1585,11 @@ static void break_fall_floor(OBJ* obj)
 
 static void SMOKE_init(OBJ* this)
 {
-    this->spr = 29;
-    this->spd.y = -0.1;
-    this->spd.x = 0.3 + P8rnd(0.2);
-    this->x += -1 + P8rnd(2);
-    this->y += -1 + P8rnd(2);
+    this->spr = P8N_I(29);
+    this->spd.y = P8N(-0.1);
+    this->spd.x = P8N(0.3) + P8rndn(P8N(0.2));
+    this->x += P8N_I(-1) + P8rndn(P8N_I(2));
+    this->y += P8N_I(-1) + P8rndn(P8N_I(2));
     this->flip_x = maybe();
     this->flip_y = maybe();
     this->solids = false;
@@ -1252,8 +1597,8 @@ static void SMOKE_init(OBJ* this)
 
 static void SMOKE_update(OBJ* this)
 {
-    this->spr += 0.2;
-    if (this->spr >= 32)
+    this->spr += P8N(0.2);
+    if (this->spr >= P8N_I(32))
     {
         destroy_object(this);
     }
@@ -1261,8 +1606,8 @@ static void SMOKE_update(OBJ* this)
 
 static void FRUIT_init(OBJ* this)
 {
-    this->start = this->y;
-    this->off = 0;
+    this->u.fruit.start = this->y;
+    this->u.fruit.off = 0;
 }
 
 static void FRUIT_update(OBJ* this)
@@ -1270,7 +1615,7 @@ static void FRUIT_update(OBJ* this)
     OBJ* hit = OBJ_collide(this, OBJ_PLAYER, 0, 0);
     if (hit != NULL)
     {
-        hit->djump = max_djump;
+        hit->u.player.djump = max_djump;
         sfx_timer = 20;
         P8sfx(13);
         got_fruit[level_index()] = true;
@@ -1278,17 +1623,17 @@ static void FRUIT_update(OBJ* this)
         destroy_object(this);
         return; //LEMON: added return to not modify dead object
     }
-    this->off += 1;
-    this->y = this->start + P8sin(this->off / 40) * 2.5f;
+    this->u.fruit.off += 1;
+    this->y = this->u.fruit.start + P8N_F(P8sin(this->u.fruit.off / 40) * 2.5f);
 }
 
 static void FLY_FRUIT_init(OBJ* this)
 {
-    this->start = this->y;
-    this->fly = false;
-    this->step = 0.5;
+    this->u.fly_fruit.start = this->y;
+    this->u.fly_fruit.fly = false;
+    this->u.fly_fruit.step = 0.5;
     this->solids = false;
-    this->sfx_delay = 8;
+    this->u.fly_fruit.sfx_delay = 8;
 }
 
 static void FLY_FRUIT_update(OBJ* this)
@@ -1296,19 +1641,19 @@ static void FLY_FRUIT_update(OBJ* this)
     bool do_destroy_object = false; //LEMON: see PLAYER_update..
     OBJ* hit;
     // Fly away.
-    if (this->fly)
+    if (this->u.fly_fruit.fly)
     {
-        if (this->sfx_delay > 0)
+        if (this->u.fly_fruit.sfx_delay > 0)
         {
-            this->sfx_delay -= 1;
-            if (this->sfx_delay <= 0)
+            this->u.fly_fruit.sfx_delay -= 1;
+            if (this->u.fly_fruit.sfx_delay <= 0)
             {
                 sfx_timer = 20;
                 P8sfx(14);
             }
         }
-        this->spd.y = appr(this->spd.y, -3.5, 0.25);
-        if (this->y < -16)
+        this->spd.y = appr(this->spd.y, P8N(-3.5), P8N(0.25));
+        if (this->y < P8N_I(-16))
         {
             do_destroy_object = true;
         }
@@ -1318,16 +1663,16 @@ static void FLY_FRUIT_update(OBJ* this)
     {
         if (has_dashed)
         {
-            this->fly = true;
+            this->u.fly_fruit.fly = true;
         }
-        this->step += 0.05;
-        this->spd.y = P8sin(this->step) * 0.5;
+        this->u.fly_fruit.step += 0.05;
+        this->spd.y = P8N_F(P8sin(this->u.fly_fruit.step) * 0.5);
     }
     // Collect.
     hit = OBJ_collide(this, OBJ_PLAYER, 0, 0);
     if (hit != NULL)
     {
-        hit->djump = max_djump;
+        hit->u.player.djump = max_djump;
         sfx_timer = 20;
         P8sfx(13);
         got_fruit[level_index()] = true;
@@ -1342,38 +1687,38 @@ static void FLY_FRUIT_update(OBJ* this)
 
 static void FLY_FRUIT_draw(OBJ* this)
 {
-    float off = 0;
-    if (!this->fly)
+    P8num off = 0;
+    if (!this->u.fly_fruit.fly)
     {
-        float dir = P8sin(this->step);
+        float dir = P8sin(this->u.fly_fruit.step);
         if (dir < 0)
         {
-            off = 1 + P8max(0, sign(this->y - this->start));
+            off = P8N_I(1) + P8max(0, sign(this->y - this->u.fly_fruit.start));
         }
     }
     else
     {
-        off = P8modulo(off + 0.25, 3);
+        off = P8modulo(off + P8N(0.25), P8N_I(3));
     }
-    P8spr(45 + off, this->x - 6, this->y - 2, 1, 1, true, false);
-    P8spr(this->spr, this->x, this->y, 1, 1, false, false);
-    P8spr(45 + off, this->x + 6, this->y - 2, 1, 1, false, false);
+    P8spr(45 + P8N_TOI(off), P8N_TOI(this->x - P8N_I(6)), P8N_TOI(this->y - P8N_I(2)), 1, 1, true, false);
+    P8spr(P8N_TOI(this->spr), P8N_TOI(this->x), P8N_TOI(this->y), 1, 1, false, false);
+    P8spr(45 + P8N_TOI(off), P8N_TOI(this->x + P8N_I(6)), P8N_TOI(this->y - P8N_I(2)), 1, 1, false, false);
 }
 
 static void LIFEUP_init(OBJ* this)
 {
-    this->spd.y = -0.25;
-    this->duration = 30;
-    this->x -= 2;
-    this->y -= 4;
-    this->flash = 0;
+    this->spd.y = P8N(-0.25);
+    this->u.lifeup.duration = 30;
+    this->x -= P8N_I(2);
+    this->y -= P8N_I(4);
+    this->u.lifeup.flash = 0;
     this->solids = false;
 }
 
 static void LIFEUP_update(OBJ* this)
 {
-    this->duration -= 1;
-    if (this->duration <= 0)
+    this->u.lifeup.duration -= 1;
+    if (this->u.lifeup.duration <= 0)
     {
         destroy_object(this);
     }
@@ -1381,9 +1726,9 @@ static void LIFEUP_update(OBJ* this)
 
 static void LIFEUP_draw(OBJ* this)
 {
-    this->flash += 0.5;
+    this->u.lifeup.flash += 0.5;
 
-    P8print("1000", this->x - 2, this->y, 7 + ((int)this->flash) % 2);
+    P8print("1000", P8N_TOI(this->x - P8N_I(2)), P8N_TOI(this->y), 7 + ((int)this->u.lifeup.flash) % 2);
 }
 
 static void FAKE_WALL_update(OBJ* this)
@@ -1391,19 +1736,19 @@ static void FAKE_WALL_update(OBJ* this)
     OBJ* hit;
     this->hitbox = (HITBOX){ .x = -1,.y = -1,.w = 18,.h = 18 };
     hit = OBJ_collide(this, OBJ_PLAYER, 0, 0);
-    if (hit != NULL && hit->dash_effect_time > 0)
+    if (hit != NULL && hit->u.player.dash_effect_time > 0)
     {
-        hit->spd.x = -sign(hit->spd.x) * 1.5;
-        hit->spd.y = -1.5;
-        hit->dash_time = -1;
+        hit->spd.x = P8N_MUL(-sign(hit->spd.x), P8N(1.5));
+        hit->spd.y = P8N(-1.5);
+        hit->u.player.dash_time = -1;
         sfx_timer = 20;
         P8sfx(16);
         //destroy_object(this);
         init_object(OBJ_SMOKE, this->x, this->y);
-        init_object(OBJ_SMOKE, this->x + 8, this->y);
-        init_object(OBJ_SMOKE, this->x, this->y + 8);
-        init_object(OBJ_SMOKE, this->x + 8, this->y + 8);
-        init_object(OBJ_FRUIT, this->x + 4, this->y + 4);
+        init_object(OBJ_SMOKE, this->x + P8N_I(8), this->y);
+        init_object(OBJ_SMOKE, this->x, this->y + P8N_I(8));
+        init_object(OBJ_SMOKE, this->x + P8N_I(8), this->y + P8N_I(8));
+        init_object(OBJ_FRUIT, this->x + P8N_I(4), this->y + P8N_I(4));
         destroy_object(this); //LEMON: moved here. see PLAYER_update. also returning to avoid modifying removed object
         return;
     }
@@ -1417,18 +1762,18 @@ static void FAKE_WALL_update(OBJ* this)
 
 static void FAKE_WALL_draw(OBJ* this)
 {
-    P8spr(64, this->x, this->y, 1, 1, false, false);
-    P8spr(65, this->x + 8, this->y, 1, 1, false, false);
-    P8spr(80, this->x, this->y + 8, 1, 1, false, false);
-    P8spr(81, this->x + 8, this->y + 8, 1, 1, false, false);
+    P8spr(64, P8N_TOI(this->x), P8N_TOI(this->y), 1, 1, false, false);
+    P8spr(65, P8N_TOI(this->x + P8N_I(8)), P8N_TOI(this->y), 1, 1, false, false);
+    P8spr(80, P8N_TOI(this->x), P8N_TOI(this->y + P8N_I(8)), 1, 1, false, false);
+    P8spr(81, P8N_TOI(this->x + P8N_I(8)), P8N_TOI(this->y + P8N_I(8)), 1, 1, false, false);
 }
 
 static void KEY_update(OBJ* this)
 {
     int is;
-    int was = P8flr(this->spr);
-    this->spr = 9 + (P8sin((float)frames / 30.0) + 0.5) * 1;
-    is = P8flr(this->spr);
+    int was = P8N_TOI(P8flr(this->spr));
+    this->spr = P8N_F(9 + (P8sin((float)frames / 30.0) + 0.5) * 1);
+    is = P8N_TOI(P8flr(this->spr));
     if (is == 10 && is != was)
     {
         this->flip_x = !this->flip_x;
@@ -1444,22 +1789,22 @@ static void KEY_update(OBJ* this)
 
 static void CHEST_init(OBJ* this)
 {
-    this->x -= 4;
-    this->start = this->x;
-    this->timer = 20;
+    this->x -= P8N_I(4);
+    this->u.chest.start = this->x;
+    this->u.chest.timer = 20;
 }
 
 static void CHEST_update(OBJ* this)
 {
     if (has_key)
     {
-        this->timer -= 1;
-        this->x = this->start - 1 + P8rnd(3);
-        if (this->timer <= 0)
+        this->u.chest.timer -= 1;
+        this->x = this->u.chest.start - P8N_I(1) + P8rndn(P8N_I(3));
+        if (this->u.chest.timer <= 0)
         {
             sfx_timer = 20;
             P8sfx(16);
-            init_object(OBJ_FRUIT, this->x, this->y - 4);
+            init_object(OBJ_FRUIT, this->x, this->y - P8N_I(4));
             destroy_object(this);
         }
     }
@@ -1467,90 +1812,90 @@ static void CHEST_update(OBJ* this)
 
 static void PLATFORM_init(OBJ* this)
 {
-    this->x -= 4;
+    this->x -= P8N_I(4);
     this->solids = false;
     this->hitbox.w = 16;
-    this->last = this->x;
+    this->u.platform.last = this->x;
 }
 
 static void PLATFORM_update(OBJ* this)
 {
-    this->spd.x = this->dir * 0.65;
-    if (this->x < -16)
+    this->spd.x = P8N_MUL(this->u.platform.dir, P8N(0.65));
+    if (this->x < P8N_I(-16))
     {
-        this->x = 128;
+        this->x = P8N_I(128);
     }
-    else if (this->x > 128)
+    else if (this->x > P8N_I(128))
     {
-        this->x = -16;
+        this->x = P8N_I(-16);
     }
     if (!OBJ_check(this, OBJ_PLAYER, 0, 0))
     {
         OBJ* hit = OBJ_collide(this, OBJ_PLAYER, 0, -1);
         if (hit != NULL)
         {
-            OBJ_move_x(hit, this->x - this->last, 1);
+            OBJ_move_x(hit, this->x - this->u.platform.last, 1);
         }
     }
-    this->last = this->x;
+    this->u.platform.last = this->x;
 }
 
 static void PLATFORM_draw(OBJ* this)
 {
-    P8spr(11, this->x, this->y - 1, 1, 1, false, false);
-    P8spr(12, this->x + 8, this->y - 1, 1, 1, false, false);
+    P8spr(11, P8N_TOI(this->x), P8N_TOI(this->y - P8N_I(1)), 1, 1, false, false);
+    P8spr(12, P8N_TOI(this->x + P8N_I(8)), P8N_TOI(this->y - P8N_I(1)), 1, 1, false, false);
 }
 
 static void MESSAGE_draw(OBJ* this)
 {
-    this->text = "-- celeste mountain --#this memorial to those# perished on the climb";
+    this->u.message.text = "-- celeste mountain --#this memorial to those# perished on the climb";
     if (OBJ_check(this, OBJ_PLAYER, 4, 0))
     {
         int i;
-        if (this->index < strlen(this->text))
+        if (this->u.message.index < P8N_I(strlen(this->u.message.text)))
         {
-            this->index += 0.5;
-            if (this->index >= this->last + 1)
+            this->u.message.index += P8N(0.5);
+            if (this->u.message.index >= this->u.message.last + P8N_I(1))
             {
-                this->last += 1;
+                this->u.message.last += P8N_I(1);
                 P8sfx(35);
             }
         }
-        this->off2.x = 8;
-        this->off2.y = 96;
-        for (i = 0; i < this->index; i++)
+        this->u.message.off2.x = 8;
+        this->u.message.off2.y = 96;
+        for (i = 0; P8N_I(i) < this->u.message.index; i++)
         {
-            if (this->text[i] != '#')
+            if (this->u.message.text[i] != '#')
             {
                 char charstr[2];
-                P8rectfill(this->off2.x - 2, this->off2.y - 2, this->off2.x + 7, this->off2.y + 6, 7);
-                charstr[0] = this->text[i], charstr[1] = '\0';
-                P8print(charstr, this->off2.x, this->off2.y, 0);
-                this->off2.x += 5;
+                P8rectfill(this->u.message.off2.x - 2, this->u.message.off2.y - 2, this->u.message.off2.x + 7, this->u.message.off2.y + 6, 7);
+                charstr[0] = this->u.message.text[i], charstr[1] = '\0';
+                P8print(charstr, this->u.message.off2.x, this->u.message.off2.y, 0);
+                this->u.message.off2.x += 5;
             }
             else
             {
-                this->off2.x = 8;
-                this->off2.y += 7;
+                this->u.message.off2.x = 8;
+                this->u.message.off2.y += 7;
             }
         }
     }
     else
     {
-        this->index = 0;
-        this->last = 0;
+        this->u.message.index = 0;
+        this->u.message.last = 0;
     }
 }
 
 static void BIG_CHEST_init(OBJ* this)
 {
-    this->state = 0;
+    this->u.big_chest.state = 0;
     this->hitbox.w = 16;
 }
 
 static void BIG_CHEST_draw(OBJ* this)
 {
-    if (this->state == 0)
+    if (this->u.big_chest.state == 0)
     {
         OBJ* hit = OBJ_collide(this, OBJ_PLAYER, 0, 8);
         if (hit != NULL && OBJ_is_solid(hit, 0, 1))
@@ -1560,54 +1905,53 @@ static void BIG_CHEST_draw(OBJ* this)
             pause_player = true;
             hit->spd.x = 0;
             hit->spd.y = 0;
-            this->state = 1;
+            this->u.big_chest.state = 1;
             init_object(OBJ_SMOKE, this->x, this->y);
-            init_object(OBJ_SMOKE, this->x + 8, this->y);
-            this->timer = 60;
-            this->particle_count = 0;
+            init_object(OBJ_SMOKE, this->x + P8N_I(8), this->y);
+            this->u.big_chest.timer = 60;
+            big_chest_particle_count = 0;
         }
-        P8spr(96, this->x, this->y, 1, 1, false, false);
-        P8spr(97, this->x + 8, this->y, 1, 1, false, false);
+        P8spr(96, P8N_TOI(this->x), P8N_TOI(this->y), 1, 1, false, false);
+        P8spr(97, P8N_TOI(this->x + P8N_I(8)), P8N_TOI(this->y), 1, 1, false, false);
     }
-    else if (this->state == 1)
+    else if (this->u.big_chest.state == 1)
     {
         int i;
-        this->timer -= 1;
+        this->u.big_chest.timer -= 1;
         shake = 5;
         flash_bg = true;
-        if (this->timer <= 45 && this->particle_count < 50)
+        if (this->u.big_chest.timer <= 45 && big_chest_particle_count < 50)
         {
-            this->particles[this->particle_count].x = 1 + P8rnd(14);
-            this->particles[this->particle_count].y = 0;
-            this->particles[this->particle_count].spd = 8 + P8rnd(8);
-            this->particles[this->particle_count].h = 32 + P8rnd(32);
-            this->particle_count++;
+            big_chest_particles[big_chest_particle_count].x = 1 + P8rnd(14);
+            big_chest_particles[big_chest_particle_count].y = 0;
+            big_chest_particles[big_chest_particle_count].spd = 8 + P8rnd(8);
+            big_chest_particles[big_chest_particle_count].h = 32 + P8rnd(32);
+            big_chest_particle_count++;
         }
-        if (this->timer < 0)
+        if (this->u.big_chest.timer < 0)
         {
-            this->state = 2;
-            this->particle_count = 0;
+            this->u.big_chest.state = 2;
+            big_chest_particle_count = 0;
             flash_bg = false;
             new_bg = true;
-            init_object(OBJ_ORB, this->x + 4, this->y + 4);
+            init_object(OBJ_ORB, this->x + P8N_I(4), this->y + P8N_I(4));
             pause_player = false;
         }
-        for (i = 0; i < this->particle_count; i++)
+        for (i = 0; i < big_chest_particle_count; i++)
         {
-            PARTICLE* p = &this->particles[i];
+            PARTICLE* p = &big_chest_particles[i];
             p->y += p->spd;
-            P8line(this->x + p->x, this->y + 8 - p->y, this->x + p->x, P8min(this->y + 8 - p->y + p->h, this->y + 8), 7);
+            P8line(P8N_TOF(this->x) + p->x, P8N_TOF(this->y) + 8 - p->y, P8N_TOF(this->x) + p->x, P8min(P8N_TOF(this->y) + 8 - p->y + p->h, P8N_TOF(this->y) + 8), 7);
         }
     }
-    P8spr(112, this->x, this->y + 8, 1, 1, false, false);
-    P8spr(113, this->x + 8, this->y + 8, 1, 1, false, false);
+    P8spr(112, P8N_TOI(this->x), P8N_TOI(this->y + P8N_I(8)), 1, 1, false, false);
+    P8spr(113, P8N_TOI(this->x + P8N_I(8)), P8N_TOI(this->y + P8N_I(8)), 1, 1, false, false);
 }
 
 static void ORB_init(OBJ* this)
 {
-    this->spd.y = -4;
+    this->spd.y = P8N_I(-4);
     this->solids = false;
-    this->particle_count = 0;
 }
 
 static void ORB_draw(OBJ* this)
@@ -1617,7 +1961,7 @@ static void ORB_draw(OBJ* this)
     float off;
     float i;
 
-    this->spd.y = appr(this->spd.y, 0, 0.5);
+    this->spd.y = appr(this->spd.y, 0, P8N(0.5));
     hit = OBJ_collide(this, OBJ_PLAYER, 0, 0);
     if (this->spd.y == 0 && hit != NULL)
     {
@@ -1627,14 +1971,14 @@ static void ORB_draw(OBJ* this)
         shake = 10;
         destroy_self = true;    //LEMON: to avoid reading off dead object
         max_djump = 2;
-        hit->djump = 2;
+        hit->u.player.djump = 2;
     }
 
-    P8spr(102, this->x, this->y, 1, 1, false, false);
+    P8spr(102, P8N_TOI(this->x), P8N_TOI(this->y), 1, 1, false, false);
     off = (float)frames / 30.f;
     for (i = 0; i <= 7; i += 1)
     {
-        P8circfill(this->x + 4 + P8cos(off + i / 8.f) * 8, this->y + 4 + P8sin(off + i / 8.f) * 8, 1, 7);
+        P8circfill(P8N_TOF(this->x) + 4 + P8cos(off + i / 8.f) * 8, P8N_TOF(this->y) + 4 + P8sin(off + i / 8.f) * 8, 1, 7);
     }
     if (destroy_self)
     {
@@ -1645,29 +1989,29 @@ static void ORB_draw(OBJ* this)
 static void FLAG_init(OBJ* this)
 {
     int i;
-    this->x += 5;
-    this->score = 0;
-    this->show = false;
+    this->x += P8N_I(5);
+    this->u.flag.score = 0;
+    this->u.flag.show = false;
     for (i = 0; i < FRUIT_COUNT; i++)
     {
         if (got_fruit[i])
         {
-            this->score += 1;
+            this->u.flag.score += 1;
         }
     }
 }
 
 static void FLAG_draw(OBJ* this)
 {
-    this->spr = 118 + P8modulo(((float)frames / 5.f), 3);
-    P8spr(this->spr, this->x, this->y, 1, 1, false, false);
-    if (this->show)
+    this->spr = P8N_I(118) + P8modulo(P8N_I(frames) / 5, P8N_I(3));
+    P8spr(P8N_TOI(this->spr), P8N_TOI(this->x), P8N_TOI(this->y), 1, 1, false, false);
+    if (this->u.flag.show)
     {
         P8rectfill(32, 2, 96, 31, 0);
         P8spr(26, 55, 6, 1, 1, false, false);
         {
             char str[16];
-            SDL_snprintf(str, sizeof(str), "x%i", this->score);
+            SDL_snprintf(str, sizeof(str), "x%i", this->u.flag.score);
             P8print(str, 64, 9, 7);
         }
         draw_time(49, 16);
@@ -1681,23 +2025,23 @@ static void FLAG_draw(OBJ* this)
     {
         P8sfx(55);
         sfx_timer = 30;
-        this->show = true;
+        this->u.flag.show = true;
     }
 }
 
 static void ROOM_TITLE_init(OBJ* this)
 {
-    this->delay = 5;
+    this->u.room_title.delay = 5;
 }
 
 static void ROOM_TITLE_draw(OBJ* this)
 {
-    this->delay -= 1;
-    if (this->delay < -30)
+    this->u.room_title.delay -= 1;
+    if (this->u.room_title.delay < -30)
     {
         destroy_object(this);
     }
-    else if (this->delay < 0)
+    else if (this->u.room_title.delay < 0)
     {
         P8rectfill(24, 58, 104, 70, 0);
         if (room.x == 3 && room.y == 1)
@@ -1724,9 +2068,8 @@ static void ROOM_TITLE_draw(OBJ* this)
 
 // object functions //
 //////////////////////-
-static OBJ* init_object(OBJTYPE type, float x, float y)
+static OBJ* init_object(OBJTYPE type, P8num x, P8num y)
 {
-    static short next_id = 0;
     OBJ* obj = NULL;
     int i;
 
@@ -1748,13 +2091,14 @@ static OBJ* init_object(OBJTYPE type, float x, float y)
         return NULL;
     }
     obj->active = true;
-    obj->id = next_id++;
+    obj->id = next_object_id++;
 
     obj->type = type;
+    type_slots[type] |= 1u << i;
     obj->collideable = true;
     obj->solids = true;
 
-    obj->spr = OBJTYPE_prop[type].tile;
+    obj->spr = P8N_I(OBJTYPE_prop[type].tile);
     obj->flip_x = obj->flip_y = false;
 
     obj->x = x;
@@ -1763,7 +2107,12 @@ static OBJ* init_object(OBJTYPE type, float x, float y)
 
     obj->spd = (VEC){ .x = 0,.y = 0 };
     obj->rem = (VEC){ .x = 0,.y = 0 };
+    SDL_memset(&obj->u, 0, sizeof obj->u);
 
+    if (trace)
+    {
+        trace(CELESTE_P8_TRACE_INIT_OBJECT, type, obj->id);
+    }
     if (OBJ_PROP(obj).init != NULL)
     {
         OBJ_PROP(obj).init(obj);
@@ -1773,8 +2122,19 @@ static OBJ* init_object(OBJTYPE type, float x, float y)
 
 static void destroy_object(OBJ* obj)
 {
+    Uint32 below = (1u << (obj - objects)) - 1;
+    int    type;
+
     // Shift all slots to the right of this object to the left, necessary to simulate loading jank
     SDL_assert(obj >= objects && obj < objects + MAX_OBJECTS);
+    if (trace)
+    {
+        trace(CELESTE_P8_TRACE_DESTROY_OBJECT, obj->type, obj->id);
+    }
+    for (type = 0; type < OBJTYPE_COUNT; type++)
+    {
+        type_slots[type] = (type_slots[type] & below) | ((type_slots[type] >> 1) & ~below);
+    }
     for (; obj + 1 < objects + MAX_OBJECTS; obj++)
     {
         *obj = *(obj + 1);
@@ -1794,8 +2154,8 @@ static void kill_player(OBJ* obj)
     {
         float angle = (dir / 8);
         dead_particles[dead_particles_count].active = true;
-        dead_particles[dead_particles_count].x = obj->x + 4;
-        dead_particles[dead_particles_count].y = obj->y + 4;
+        dead_particles[dead_particles_count].x = P8N_TOF(obj->x) + 4;
+        dead_particles[dead_particles_count].y = P8N_TOF(obj->y) + 4;
         dead_particles[dead_particles_count].t = 10;
         dead_particles[dead_particles_count].spd2.x = P8sin(angle) * 3;
         dead_particles[dead_particles_count].spd2.y = P8cos(angle) * 3;
@@ -1850,15 +2210,21 @@ static void load_room(int x, int y)
     has_dashed = false;
     has_key = false;
     room_just_loaded = true;
+    if (trace)
+    {
+        trace(CELESTE_P8_TRACE_LOAD_ROOM, x, y);
+    }
 
     for (i = 0; i < MAX_OBJECTS; i++)
     {
         objects[i].active = false;
     }
+    SDL_memset(type_slots, 0, sizeof type_slots);
 
     // Current room.
     room.x = x;
     room.y = y;
+    build_room_masks();
 
     // Entities.
     for (tx = 0; tx <= 15; tx++)
@@ -1868,11 +2234,11 @@ static void load_room(int x, int y)
             int tile = P8mget(room.x * 16 + tx, room.y * 16 + ty);
             if (tile == 11)
             {
-                init_object(OBJ_PLATFORM, tx * 8, ty * 8)->dir = -1;
+                init_object(OBJ_PLATFORM, P8N_I(tx * 8), P8N_I(ty * 8))->u.platform.dir = P8N_I(-1);
             }
             else if (tile == 12)
             {
-                init_object(OBJ_PLATFORM, tx * 8, ty * 8)->dir = 1;
+                init_object(OBJ_PLATFORM, P8N_I(tx * 8), P8N_I(ty * 8))->u.platform.dir = P8N_I(1);
             }
             else
             {
@@ -1881,7 +2247,7 @@ static void load_room(int x, int y)
                 {
                     if (tile == OBJTYPE_prop[type].tile)
                     {
-                        init_object((OBJTYPE)type, tx * 8, ty * 8);
+                        init_object((OBJTYPE)type, P8N_I(tx * 8), P8N_I(ty * 8));
                     }
                 }
             }
@@ -2019,8 +2385,14 @@ void Celeste_P8_draw()
     int i;
     int off;
 
+    if (draw_list)
+    {
+        draw_list_begin();
+    }
+
     if (freeze > 0)
     {
+        draw_list_done = true;
         return;
     }
 
@@ -2154,7 +2526,7 @@ redo_draw:;
             {
                 p->active = false;
             }
-            P8rectfill(p->x - p->t / 5, p->y - p->t / 5, p->x + p->t / 5, p->y + p->t / 5, 14 + P8modulo(p->t, 2));
+            P8rectfill(p->x - p->t / 5, p->y - p->t / 5, p->x + p->t / 5, p->y + p->t / 5, 14 + fmodf(p->t, 2));
         }
 
         p++;
@@ -2192,11 +2564,13 @@ redo_draw:;
         }
         if (p != NULL)
         {
-            float diff = P8min(24, 40 - P8abs(p->x + 4 - 64));
+            float diff = P8min(24, 40 - P8N_TOF(P8abs(p->x + P8N_I(4) - P8N_I(64))));
             P8rectfill(0, 0, diff, 128, 0);
             P8rectfill(128 - diff, 0, 128, 128, 0);
         }
     }
+
+    draw_list_done = true;
 }
 
 static void draw_object(OBJ* obj)
@@ -2207,7 +2581,7 @@ static void draw_object(OBJ* obj)
     }
     else if (obj->spr > 0)
     {
-        P8spr(obj->spr, obj->x, obj->y, 1, 1, obj->flip_x, obj->flip_y);
+        P8spr(P8N_TOI(obj->spr), P8N_TOI(obj->x), P8N_TOI(obj->y), 1, 1, obj->flip_x, obj->flip_y);
     }
 }
 
@@ -2227,21 +2601,21 @@ static void draw_time(float x, float y)
 
 // helper functions //
 //////////////////////
-static float clamp(float val, float a, float b)
+static P8num clamp(P8num val, P8num a, P8num b)
 {
-    return P8max(a, P8min(b, val));
+    return val < a ? a : (val > b ? b : val);
 }
 
-static float appr(float val, float target, float amount)
+static P8num appr(P8num val, P8num target, P8num amount)
 {
     return val > target
-        ? P8max(val - amount, target)
-        : P8min(val + amount, target);
+        ? (val - amount > target ? val - amount : target)
+        : (val + amount < target ? val + amount : target);
 }
 
-static float sign(float v)
+static P8num sign(P8num v)
 {
-    return v > 0 ? 1 : (v < 0 ? -1 : 0);
+    return v > 0 ? P8N_I(1) : (v < 0 ? P8N_I(-1) : 0);
 }
 
 static bool maybe()
@@ -2259,18 +2633,27 @@ static bool ice_at(int x, int y, int w, int h)
     return tile_flag_at(x, y, w, h, 4);
 }
 
+// Bits lo..hi of a room row, or 0 if the range is empty.  Callers clamp
+// lo to >= 0 and hi to <= 15.
+static inline Uint16 row_span(int lo, int hi)
+{
+    return lo > hi ? 0 : (Uint16)((2u << hi) - (1u << lo));
+}
+
 static bool tile_flag_at(int x, int y, int w, int h, int flag)
 {
-    int i;
-    for (i = (int)P8max(0, P8flr(x / 8)); i <= P8min(15, (x + w - 1) / 8); i++)
+    // Same tile range as looping from max(0, x / 8) to min(15, (x + w - 1) / 8)
+    // with C's truncating division, which matters for hitboxes left of or
+    // above the room.
+    Uint16 cols = row_span(x / 8 > 0 ? x / 8 : 0, (x + w - 1) / 8 < 15 ? (x + w - 1) / 8 : 15);
+    int    j, j1 = (y + h - 1) / 8 < 15 ? (y + h - 1) / 8 : 15;
+
+    stats.tile_queries++;
+    for (j = y / 8 > 0 ? y / 8 : 0; j <= j1; j++)
     {
-        int j;
-        for (j = (int)P8max(0, P8flr(y / 8)); j <= P8min(15, (y + h - 1) / 8); j++)
+        if (room_flag_mask[flag][j] & cols)
         {
-            if (P8fget(tile_at(i, j), flag))
-            {
-                return true;
-            }
+            return true;
         }
     }
     return false;
@@ -2281,31 +2664,92 @@ static int tile_at(int x, int y)
     return P8mget(room.x * 16 + x, room.y * 16 + y);
 }
 
-static bool spikes_at(float x, float y, int w, int h, float xspd, float yspd)
+static void build_room_masks(void)
 {
-    int i;
-    for (i = (int)P8max(0, P8flr(x / 8)); i <= P8min(15, (x + w - 1) / 8); i++)
+    Sint16 tile_flags[256]; // fget() results per tile, -1 until first asked.
+    int    i, j, f;
+
+    SDL_memset(room_flag_mask, 0, sizeof room_flag_mask);
+    SDL_memset(room_spike_mask, 0, sizeof room_spike_mask);
+    SDL_memset(tile_flags, 0xff, sizeof tile_flags);
+    for (j = 0; j <= 15; j++)
     {
-        int j;
-        for (j = (int)P8max(0, P8flr(y / 8)); j <= P8min(15, (y + h - 1) / 8); j++)
+        for (i = 0; i <= 15; i++)
         {
-            int tile = tile_at(i, j);
-            if (tile == 17 && (P8modulo(y + h - 1, 8) >= 6 || y + h == j * 8 + 8) && yspd >= 0)
+            int tile = tile_at(i, j) & 0xff;
+            if (tile_flags[tile] < 0)
             {
-                return true;
+                tile_flags[tile] = 0;
+                for (f = 0; f < 8; f++)
+                {
+                    tile_flags[tile] |= P8fget(tile, f) << f;
+                }
             }
-            else if (tile == 27 && P8modulo(y, 8) <= 2 && yspd <= 0)
+            for (f = 0; f < 8; f++)
             {
-                return true;
+                if (tile_flags[tile] & (1 << f))
+                {
+                    room_flag_mask[f][j] |= 1 << i;
+                }
             }
-            else if (tile == 43 && P8modulo(x, 8) <= 2 && xspd <= 0)
+
+            switch (tile)
             {
-                return true;
+                case 17: room_spike_mask[SPIKES_UP][j] |= 1 << i; break;
+                case 27: room_spike_mask[SPIKES_DOWN][j] |= 1 << i; break;
+                case 43: room_spike_mask[SPIKES_RIGHT][j] |= 1 << i; break;
+                case 59: room_spike_mask[SPIKES_LEFT][j] |= 1 << i; break;
             }
-            else if (tile == 59 && (P8modulo(x + w - 1, 8) >= 6 || x + w == i * 8 + 8) && xspd >= 0)
+        }
+    }
+}
+
+// Last tile index i with P8N_I(i) <= v, for the upper bounds below.
+static inline int spikes_last(P8num v)
+{
+    return v < 0 ? -1 : (v >= P8N_I(15) ? 15 : P8N_TOI(v));
+}
+
+static bool spikes_at(P8num x, P8num y, int w, int h, P8num xspd, P8num yspd)
+{
+    int    i0 = P8N_TOI(P8flr(x / 8)), j0 = P8N_TOI(P8flr(y / 8));
+    Uint16 cols = row_span(i0 > 0 ? i0 : 0, spikes_last((x + P8N_I(w) - P8N_I(1)) / 8));
+    int    j, j1 = spikes_last((y + P8N_I(h) - P8N_I(1)) / 8);
+
+    stats.tile_queries++;
+    for (j = j0 > 0 ? j0 : 0; j <= j1; j++)
+    {
+        Uint16 left = room_spike_mask[SPIKES_LEFT][j] & cols;
+
+        if ((room_spike_mask[SPIKES_UP][j] & cols) && (P8modulo(y + P8N_I(h) - P8N_I(1), P8N_I(8)) >= P8N_I(6) || y + P8N_I(h) == P8N_I(j * 8 + 8)) && yspd >= 0)
+        {
+            return true;
+        }
+        else if ((room_spike_mask[SPIKES_DOWN][j] & cols) && P8modulo(y, P8N_I(8)) <= P8N_I(2) && yspd <= 0)
+        {
+            return true;
+        }
+        else if ((room_spike_mask[SPIKES_RIGHT][j] & cols) && P8modulo(x, P8N_I(8)) <= P8N_I(2) && xspd <= 0)
+        {
+            return true;
+        }
+        else if (left && xspd >= 0)
+        {
+            // The flush case only hits the tile whose right edge is x + w.
+            P8num right = x + P8N_I(w);
+
+            if (P8modulo(right - P8N_I(1), P8N_I(8)) >= P8N_I(6))
             {
                 return true;
             }
+            if (P8flr(right) == right && P8modulo(right, P8N_I(8)) == 0)
+            {
+                int i = P8N_TOI(right) / 8 - 1;
+                if (i >= 0 && i <= 15 && (left & (1 << i)))
+                {
+                    return true;
+                }
+            }
         }
     }
     return false;
@@ -2330,7 +2774,8 @@ void Celeste_P8__DEBUG(void)
         V(room) V(freeze) V(shake) V(will_restart) V(delay_restart) V(got_fruit) \
         V(has_dashed) V(sfx_timer) V(has_key) V(pause_player) V(flash_bg) V(music_timer) \
         V(new_bg) V(frames) V(seconds) V(minutes) V(deaths) V(max_djump) V(start_game) \
-        V(start_game_flash) V(clouds) V(particles) V(dead_particles) V(objects)
+        V(start_game_flash) V(clouds) V(particles) V(dead_particles) V(objects) V(next_object_id) \
+        V(hair) V(big_chest_particles) V(big_chest_particle_count)
 
 size_t Celeste_P8_get_state_size(void)
 {
@@ -2361,6 +2806,14 @@ void Celeste_P8_load_state(const void* st_)
 #define V_LOAD(v) memcpy(&v, st, sizeof v), st += sizeof v;
     LISTGVARS(V_LOAD)
 #undef V_LOAD
+    build_room_masks();
+    rebuild_type_slots();
+}
+
+void Celeste_P8_get_stats(Celeste_P8_stats_t* st)
+{
+    SDL_assert(st != NULL);
+    *st = stats;
 }
 
 #undef LISTGVARS
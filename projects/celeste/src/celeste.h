@@ -20,7 +20,66 @@ typedef enum
 typedef _Bool Celeste_P8_bool_t;
 typedef int (*Celeste_P8_cb_func_t) (CELESTE_P8_CALLBACK_TYPE calltype, ...);
 
-extern void Celeste_P8_set_call_func(Celeste_P8_cb_func_t func);
+//one direct entry per PICO-8 primitive, all of them must be set
+struct Celeste_P8_backend
+{
+    void (*music)(int track, int fade, int mask);
+    void (*spr)(int sprite, int x, int y, int cols, int rows, Celeste_P8_bool_t flipx, Celeste_P8_bool_t flipy);
+    Celeste_P8_bool_t (*btn)(int b);
+    void (*sfx)(int id);
+    void (*pal)(int a, int b);
+    void (*pal_reset)(void);
+    void (*circfill)(int x, int y, int r, int c);
+    void (*print)(const char* str, int x, int y, int c);
+    void (*rectfill)(int x, int y, int x2, int y2, int c);
+    void (*line)(int x, int y, int x2, int y2, int c);
+    int (*mget)(int x, int y);
+    void (*camera)(int x, int y);
+    Celeste_P8_bool_t (*fget)(int tile, int flag);
+    void (*map)(int mx, int my, int tx, int ty, int mw, int mh, int mask);
+};
+
+extern void Celeste_P8_set_backend(const struct Celeste_P8_backend* backend); //the table is copied
+extern void Celeste_P8_set_call_func(Celeste_P8_cb_func_t func); //variadic alternative, dispatched through an adapter table
+
+//draw command list, filled by Celeste_P8_draw() instead of calling the
+//drawing primitives when one is set with Celeste_P8_set_draw_list()
+#define CELESTE_P8_DRAW_LIST_SIZE 512
+#define CELESTE_P8_DRAW_TEXT_SIZE 512
+
+typedef struct
+{
+    unsigned char type;  //CELESTE_P8_SPR, CELESTE_P8_PAL, ... CELESTE_P8_MAP
+    unsigned char flags; //spr(): bit 0 flip x, bit 1 flip y
+    short args[7];       //in the order of the primitive's arguments, print() has the offset of its text first
+
+} Celeste_P8_draw_cmd_t;
+
+typedef struct
+{
+    int count;     //commands issued by the last draw, more than CELESTE_P8_DRAW_LIST_SIZE if some were dropped
+    int text_size; //bytes of text used, likewise
+    Celeste_P8_draw_cmd_t cmds[CELESTE_P8_DRAW_LIST_SIZE];
+    char text[CELESTE_P8_DRAW_TEXT_SIZE];
+
+} Celeste_P8_draw_list_t;
+
+extern void Celeste_P8_set_draw_list(Celeste_P8_draw_list_t* list); //NULL to draw immediately again
+extern void Celeste_P8_run_draw_list(const Celeste_P8_draw_list_t* list, const struct Celeste_P8_backend* backend); //NULL backend for the installed one
+
+//engine events, reported to a function set with Celeste_P8_set_trace()
+typedef enum
+{
+    CELESTE_P8_TRACE_LOAD_ROOM,     //a, b: room x and y
+    CELESTE_P8_TRACE_INIT_OBJECT,   //a: object type, b: object id
+    CELESTE_P8_TRACE_DESTROY_OBJECT //likewise
+
+} CELESTE_P8_TRACE_TYPE;
+
+typedef void (*Celeste_P8_trace_func_t)(CELESTE_P8_TRACE_TYPE type, int a, int b);
+
+extern void Celeste_P8_set_trace(Celeste_P8_trace_func_t func); //NULL to stop
+
 extern void Celeste_P8_set_rndseed(unsigned seed);
 extern void Celeste_P8_init(void);
 extern void Celeste_P8_update(void);
@@ -28,6 +87,17 @@ extern void Celeste_P8_draw(void);
 
 extern void Celeste_P8__DEBUG(void); //debug functionality
 
+//statistics, counted since startup
+typedef struct
+{
+    unsigned tile_queries;   //solid_at(), ice_at() and spikes_at() calls
+    unsigned obj_queries;    //object collision checks
+    unsigned obj_candidates; //objects tested by those checks
+
+} Celeste_P8_stats_t;
+
+extern void Celeste_P8_get_stats(Celeste_P8_stats_t* st);
+
 //state functionality
 size_t Celeste_P8_get_state_size(void);
 void Celeste_P8_save_state(void* st);
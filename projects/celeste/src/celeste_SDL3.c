@@ -15,87 +15,168 @@
 #include <SDL3/SDL.h>
 #include <SDL3_mixer/SDL_mixer.h>
 #include "celeste_SDL3.h"
+#include "bundle.h"
 #include "celeste.h"
+#include "golden.h"
+#include "palette.h"
+#include "replay.h"
+#include "raster.h"
+#include "resolve.h"
+#include "rewind.h"
+#include "sprite.h"
 #include "tilemap.h"
+#include "trace.h"
 
 extern SDL_Renderer* renderer;
 
 static SDL_Texture* SDL_screen = NULL;
 static SDL_Texture* frame = NULL;
-static SDL_Surface* screen = NULL;
-static SDL_Surface* gfx = NULL;
-static SDL_Surface* font = NULL;
-static Mix_Chunk* snd[64] = { NULL };
+static SDL_Surface* screen = NULL; // PICO-8 color indices, resolved into SDL_screen by Flip().
+static SDL_Surface* canvas = NULL; // Staging for uploads to SDL_screen, unless they go straight into it.
+#ifdef CELESTE_ZERO_COPY
+static _Bool zero_copy = 1;
+#endif
+static Sprite_Sheet gfx;
+static Sprite_Sheet font;
+static Bundle bundle; // Converted data files, if BUNDLE_NAME was found.
 #if ENABLE_MUSIC
 static Mix_Music* mus[6] = { NULL };
 #endif
 
-static const SDL_Color base_palette_colors[16] =
-{
-    { 0x00, 0x00, 0x00 },
-    { 0x1d, 0x2b, 0x53 },
-    { 0x7e, 0x25, 0x53 },
-    { 0x00, 0x87, 0x51 },
-    { 0xab, 0x52, 0x36 },
-    { 0x5f, 0x57, 0x4f },
-    { 0xc2, 0xc3, 0xc7 },
-    { 0xff, 0xf1, 0xe8 },
-    { 0xff, 0x00, 0x4d },
-    { 0xff, 0xa3, 0x00 },
-    { 0xff, 0xec, 0x27 },
-    { 0x00, 0xe4, 0x36 },
-    { 0x29, 0xad, 0xff },
-    { 0x83, 0x76, 0x9c },
-    { 0xff, 0x77, 0xa8 },
-    { 0xff, 0xcc, 0xaa }
-};
-
-static SDL_Color palette_colors[16];
-static SDL_Palette palette;
-static Uint32 map[16];
+static Uint8  draw_palette[16]; // pal(a,b) draws color a as b.
+static _Bool  draw_palette_set; // Whether draw_palette changes any color.
+static Resolve_Table resolve;   // The colors in SDL_screen's pixel format.
 
-#define getcolor(col) map[col % 16]
+#define getcolor(col) draw_palette[col % 16]
 
 static Uint16 buttons_state = 0;
 static _Bool enable_screenshake = 1;
+static int camera_x = 0, camera_y = 0;
 static _Bool paused = 0;
 static void* initial_game_state = NULL;
 static void* game_state = NULL;
 static Mix_Music* current_music = NULL;
 static Mix_Music* game_state_music = NULL;
+static _Bool recording = 0;
+static _Bool replaying = 0;
+
+// Golden image run, see StartGolden().
+static _Bool golden = 0;
+static _Bool golden_recording = 0;
+static char  golden_path[256];
+
+// Fixed timestep, see Iterate().
+static Uint64     pace_last = 0; // SDL_GetPerformanceCounter() at the last Iterate().
+static Uint64     pace_lag = 0;  // Time owed to the game, in the same ticks.
+static PacerStats pacer_stats;
+
+// Fast forward, see Turbo().
+static Uint64      turbo_start = 0; // SDL_GetPerformanceCounter() when 0 was pressed, 0 while it isn't held.
+static Uint64      turbo_frames = 0;
+static TimingPhase turbo_update;    // timing_stats.session[TIMING_UPDATE] then.
+static _Bool       quiet = 0;       // sfx() is ignored.
+
+#ifdef CELESTE_DRAW_LIST
+static Celeste_P8_draw_list_t draw_list;
+#endif
 
 // On-screen display (for info, such as loading a state, toggling screenshake, toggling fullscreen, etc).
 static char osd_text[200] = "";
 static int  osd_timer = 0;
 
-static Uint32 getpixel(SDL_Surface* surface, int x, int y);
-static int gettileflag(int tile, int flag);
-static void loadbmpscale(char* filename, SDL_Surface** s);
+// Regions of screen drawn to since the last Flip(), which uploads only those.
+static SDL_Rect    dirty[DIRTY_MAX];
+static int         dirty_count = 0;
+static UploadStats upload_stats;
+
+// Map layers drawn before, prerendered, see DrawMapLayer().
+typedef struct
+{
+    int          mx, my, size, mask;
+    Uint64       used; // map_cache_clock when last drawn.
+    Sprite_Sheet sheet;
+
+} MapLayer;
 
+static MapLayer      map_layers[MAP_CACHE_LAYERS];
+static Uint64        map_cache_clock = 0;
+static MapCacheStats map_cache_stats;
+
+// Sounds played before, see emu_sfx().
+typedef struct
+{
+    Mix_Chunk* chunk;
+    Uint8*     pcm;    // Bundled samples converted for the mixer, if it didn't get BUNDLE_PCM_RATE.
+    size_t     bytes;  // Memory held for the samples, none when played from the bundle.
+    Uint64     used;   // sound_cache_clock when last played.
+    _Bool      pinned;
+    _Bool      failed; // Not tried again.
+
+} Sound;
+
+static Sound           sounds[64];
+static Uint64          sound_cache_clock = 0;
+static SoundCacheStats sound_cache_stats;
+
+// Time spent in each part of Iterate(), see TimePhase().  The window
+// becomes timing_stats.last every TIMING_WINDOW frames, and is drawn
+// below the game while show_timing is on.
+static const char* const timing_names[TIMING_PHASES] = { "inp", "upd", "rew", "drw", "osd", "flp" };
+static const char* const trace_names[TIMING_PHASES] = { "input", "update", "rewind", "draw", "osd", "flip" };
+
+static TimingPhase timing_window[TIMING_PHASES];
+static int         timing_frames = 0;
+static TimingStats timing_stats;
+static _Bool       show_timing = 0;
+
+static int gettileflag(int tile, int flag);
+static int maptileshown(int tile, int mask);
+static void loadbmpscale(char* filename, Sprite_Sheet* s, int flags);
+static SDL_IOStream* OpenData(const char* name);
+static Mix_Chunk* LoadSound(const char* name, Uint8** pcm);
+static int CacheSound(int id);
+static void FreeSounds(void);
+
+static SDL_PixelFormat ChooseFormat(void);
+static _Bool CreateCanvas(SDL_PixelFormat format);
 static void Flip();
+static Uint64 TimePhase(int phase, Uint64 start);
+static void DrawTiming(float top);
+static void Damage(int x, int y, int w, int h);
+static void FillRect(const SDL_Rect* rect, Uint32 color);
 static void LoadData(void);
 static void SetPaletteEntry(unsigned char idx, unsigned char base_idx);
-static void RefreshPalette(void);
+static int RefreshPalette(SDL_PixelFormat format);
 static void ResetPalette(void);
 
+static void ResetGame(unsigned seed);
+static void ReplayPath(char* path, size_t size);
+#ifdef CELESTE_TRACE
+static void TracePath(char* path, size_t size);
+static void emu_trace(CELESTE_P8_TRACE_TYPE type, int a, int b);
+#endif
+static void DrawFrame(void);
+static SDL_AppResult Turbo(Uint64 now);
+
 static void OSDset(const char* fmt, ...);
 static void OSDdraw(void);
 
 static void p8_line(int x0, int y0, int x1, int y1, unsigned char color);
 static void p8_print(const char* str, int x, int y, int col);
 static void p8_rectfill(int x0, int y0, int x1, int y1, int col);
-static int pico8emu(CELESTE_P8_CALLBACK_TYPE call, ...);
-static inline void Xblit(SDL_Surface* src, SDL_Rect* srcrect, SDL_Surface* dst, SDL_Rect* dstrect, int color, int flipx, int flipy);
+static const struct Celeste_P8_backend pico8emu;
+static void Blit(const Sprite_Sheet* sheet, int tile, int x, int y, int color, int flip);
+static int DrawMapLayer(int mx, int my, int tx, int ty, int size, int mask);
+static void FreeMapLayers(void);
 
 #define LOGLOAD(w) SDL_Log("loading %s...", w)
 #define LOGDONE() SDL_Log("done")
 
 int Init()
 {
-    int pico8emu(CELESTE_P8_CALLBACK_TYPE call, ...);
-
-    SDL_PixelFormat format = SDL_PIXELFORMAT_XRGB4444;
+    SDL_PixelFormat format = ChooseFormat();
 
+    SDL_Log("screen texture: %s", SDL_GetPixelFormatName(format));
     SDL_screen = SDL_CreateTexture(renderer, format, SDL_TEXTUREACCESS_STREAMING, PICO8_W, PICO8_H);
     if (!SDL_screen)
     {
@@ -103,23 +184,35 @@ int Init()
         return false;
     }
 
-    screen = SDL_CreateSurface(PICO8_W, PICO8_H, format);
+    screen = SDL_CreateSurface(PICO8_W, PICO8_H, SDL_PIXELFORMAT_INDEX8);
     if (!screen)
     {
         SDL_Log("SDL_CreateSurface: %s\n", SDL_GetError());
         return false;
     }
+#ifndef CELESTE_ZERO_COPY
+    if (!CreateCanvas(format))
+    {
+        return false;
+    }
+#endif
+    SDL_FillSurfaceRect(screen, NULL, 0);
+    Damage(0, 0, screen->w, screen->h);
 
     SDL_AudioSpec spec;
     spec.channels = 1;
     spec.format = SDL_AUDIO_S16;
-    spec.freq = 8000;
+    spec.freq = BUNDLE_PCM_RATE;
 
     if (!Mix_OpenAudio(0, &spec))
     {
         SDL_Log("Mix_Init: %s", SDL_GetError());
     }
 
+    if (!RefreshPalette(format))
+    {
+        return false;
+    }
     ResetPalette();
     SDL_HideCursor();
 
@@ -127,7 +220,16 @@ int Init()
     SDL_Log("now loading...");
 
     LoadData();
-    Celeste_P8_set_call_func(pico8emu);
+    Celeste_P8_set_backend(&pico8emu);
+#ifdef CELESTE_DRAW_LIST
+    Celeste_P8_set_draw_list(&draw_list);
+#endif
+#ifdef CELESTE_TRACE
+    if (Trace_Init(TRACE_EVENTS))
+    {
+        Celeste_P8_set_trace(emu_trace);
+    }
+#endif
 
     // For reset.
     initial_game_state = SDL_malloc(Celeste_P8_get_state_size());
@@ -140,10 +242,13 @@ int Init()
 
     Celeste_P8_init();
 
-    char tmpath[256];
-    SDL_snprintf(tmpath, sizeof(tmpath), "%sdata/frame.bmp", SDL_GetBasePath());
+    if (!Rewind_Init(REWIND_BUDGET, REWIND_KEYFRAME_INTERVAL))
+    {
+        SDL_Log("Rewind disabled");
+    }
 
-    SDL_Surface* frame_sf = SDL_LoadBMP(tmpath);
+    SDL_IOStream* frame_io = OpenData("frame.bmp");
+    SDL_Surface* frame_sf = frame_io ? SDL_LoadBMP_IO(frame_io, true) : NULL;
     if (!frame_sf)
     {
         SDL_Log("Failed to load image frame.bmp: %s", SDL_GetError());
@@ -177,6 +282,10 @@ SDL_AppResult HandleEvents(SDL_Event* ev)
             {
                 break;
             }
+            if (golden) // Keys would change what the replay draws.
+            {
+                break;
+            }
 
             if (ev->key.key == SDLK_SOFTRIGHT) // Do pause.
             {
@@ -200,8 +309,9 @@ SDL_AppResult HandleEvents(SDL_Event* ev)
             {
                 return SDL_APP_SUCCESS;
             }
-            else if (ev->key.key == SDLK_HASH) // Toggle FPS.
+            else if (ev->key.key == SDLK_HASH) // Toggle timing.
             {
+                show_timing = !show_timing;
                 SDL_RenderTexture(renderer, frame, NULL, NULL);
             }
             else if (ev->key.key == SDLK_1) // Save state.
@@ -210,6 +320,7 @@ SDL_AppResult HandleEvents(SDL_Event* ev)
                 if (game_state)
                 {
                     OSDset("save state");
+                    Trace_Instant("save_state", NULL, 0, 0);
                     Celeste_P8_save_state(game_state);
                     game_state_music = current_music;
 
@@ -218,6 +329,9 @@ SDL_AppResult HandleEvents(SDL_Event* ev)
                     FILE* savefile = fopen(tmpath, "wb+");
                     if (savefile)
                     {
+                        const Uint32 header[2] = { SAVE_MAGIC, (Uint32)Celeste_P8_get_state_size() };
+
+                        fwrite(header, sizeof(header), 1, savefile);
                         fwrite(game_state, Celeste_P8_get_state_size(), 1, savefile);
                         fclose(savefile);
                     }
@@ -230,20 +344,24 @@ SDL_AppResult HandleEvents(SDL_Event* ev)
                 FILE* savefile = fopen(tmpath, "rb");
                 if (savefile)
                 {
-                    if (!game_state)
-                    {
-                        game_state = SDL_malloc(Celeste_P8_get_state_size());
-                        if (!game_state)
-                        {
-                            fclose(savefile);
-                            break;
-                        }
-                    }
-                    if (game_state)
+                    // Only a whole state of this build's size replaces the one in memory.
+                    Uint32 header[2];
+                    void*  loaded = SDL_malloc(Celeste_P8_get_state_size());
+                    _Bool  ok = loaded &&
+                                fread(header, sizeof(header), 1, savefile) == 1 &&
+                                header[0] == SAVE_MAGIC && header[1] == Celeste_P8_get_state_size() &&
+                                fread(loaded, Celeste_P8_get_state_size(), 1, savefile) == 1;
+
+                    fclose(savefile);
+                    if (!ok)
                     {
-                        fread(game_state, Celeste_P8_get_state_size(), 1, savefile);
+                        SDL_Log("%s: not a save state of this build", tmpath);
+                        OSDset("can't load state");
+                        SDL_free(loaded);
+                        break;
                     }
-                    fclose(savefile);
+                    SDL_free(game_state);
+                    game_state = loaded;
                 }
 
                 if (game_state)
@@ -257,7 +375,11 @@ SDL_AppResult HandleEvents(SDL_Event* ev)
                         Mix_ResumeMusic();
 #endif
                     }
+                    Trace_Instant("load_state", NULL, 0, 0);
                     Celeste_P8_load_state(game_state);
+                    Rewind_Clear();
+                    Replay_Stop();
+                    recording = replaying = 0;
                     if (current_music != game_state_music)
                     {
 #if ENABLE_MUSIC
@@ -273,9 +395,47 @@ SDL_AppResult HandleEvents(SDL_Event* ev)
                     }
                 }
             }
+            else if (ev->key.key == SDLK_8) // Start/stop recording a replay.
+            {
+                char path[256];
+                ReplayPath(path, sizeof(path));
+
+                if (recording)
+                {
+                    OSDset(Replay_Save(path) ? "replay saved" : "replay not saved");
+                    Replay_Stop();
+                    recording = 0;
+                }
+                else if (initial_game_state)
+                {
+                    unsigned seed = (unsigned)(time(NULL) + SDL_GetTicks());
+
+                    ResetGame(seed);
+                    recording = Replay_StartRecording(seed);
+                    OSDset(recording ? "recording" : "can't record");
+                }
+            }
+            else if (ev->key.key == SDLK_9) // Play back the replay.
+            {
+                char          path[256];
+                Replay_Header header;
+                ReplayPath(path, sizeof(path));
+
+                if (initial_game_state && Replay_Load(path, &header))
+                {
+                    ResetGame(header.seed);
+                    replaying = 1;
+                    OSDset(Replay_HashState() == header.initial_hash ? "replay" : "replay (other build)");
+                }
+                else
+                {
+                    OSDset("no replay");
+                }
+            }
             else if (ev->key.key == SDLK_3) // Toggle screenshake.
             {
                 enable_screenshake = !enable_screenshake;
+                camera_x = camera_y = 0;
                 OSDset("screenshake: %s", enable_screenshake ? "on" : "off");
             }
             else if (ev->key.key == SDLK_6)
@@ -301,11 +461,15 @@ SDL_AppResult HandleEvents(SDL_Event* ev)
     return SDL_APP_CONTINUE;
 }
 
-int Iterate()
+// Runs a game frame, without drawing it if draw is false.
+static SDL_AppResult Step(_Bool draw)
 {
     int numkeys;
     const bool* kbstate = SDL_GetKeyboardState(&numkeys);
     static int reset_input_timer = 0;
+    static _Bool rewinding = 0;
+    const Uint64 start = SDL_GetPerformanceCounter();
+    Uint64 t = start;
 
     // Hold C (backspace) to reset.
     if (initial_game_state != NULL && kbstate[SDL_SCANCODE_BACKSPACE])
@@ -315,14 +479,8 @@ int Iterate()
         {
             reset_input_timer = 0;
             OSDset("reset");
-            paused = 0;
-            Celeste_P8_load_state(initial_game_state);
-            Celeste_P8_set_rndseed((unsigned)(time(NULL) + SDL_GetTicks()));
-            Mix_HaltChannel(-1);
-#if ENABLE_MUSIC
-            Mix_HaltMusic();
-#endif
-            Celeste_P8_init();
+            ResetGame((unsigned)(time(NULL) + SDL_GetTicks()));
+            Replay_Stop();
         }
     }
     else
@@ -339,27 +497,257 @@ int Iterate()
     if (kbstate[SDL_SCANCODE_7])     buttons_state |= (1 << 4);
     if (kbstate[SDL_SCANCODE_5])     buttons_state |= (1 << 5);
 
+    if (replaying && !paused && !Replay_NextFrame(&buttons_state))
+    {
+        replaying = 0;
+        Replay_Stop();
+        OSDset("replay done");
+        if (golden)
+        {
+            int ok = golden_recording ? Golden_Save(golden_path) : Golden_Checked();
+
+            Golden_Stop();
+            golden = 0;
+            return ok ? SDL_APP_SUCCESS : SDL_APP_FAILURE;
+        }
+    }
+    t = TimePhase(TIMING_INPUT, t);
+
     if (paused)
     {
         const int x0 = PICO8_W / 2 - 3 * 4, y0 = 8;
 
-        p8_rectfill(x0 - 1, y0 - 1, 6 * 4 + x0 + 1, 6 + y0 + 1, 6);
-        p8_rectfill(x0, y0, 6 * 4 + x0, 6 + y0, 0);
-        p8_print("paused", x0 + 1, y0 + 1, 7);
+        if (draw)
+        {
+            p8_rectfill(x0 - 1, y0 - 1, 6 * 4 + x0 + 1, 6 + y0 + 1, 6);
+            p8_rectfill(x0, y0, 6 * 4 + x0, 6 + y0, 0);
+            p8_print("paused", x0 + 1, y0 + 1, 7);
+            t = TimePhase(TIMING_DRAW, t);
+        }
+    }
+    else if (kbstate[SDL_SCANCODE_4] && !recording && !replaying) // Hold 4 to rewind.
+    {
+        if (!rewinding)
+        {
+            OSDset("rewind");
+            rewinding = 1;
+        }
+        Rewind_Step();
+        t = TimePhase(TIMING_REWIND, t);
+        if (draw)
+        {
+            DrawFrame();
+            t = TimePhase(TIMING_DRAW, t);
+        }
     }
     else
     {
+        rewinding = 0;
+        if (recording)
+        {
+            Replay_RecordFrame(buttons_state);
+        }
         Celeste_P8_update();
-        Celeste_P8_draw();
+        t = TimePhase(TIMING_UPDATE, t);
+        Rewind_Push();
+        t = TimePhase(TIMING_REWIND, t);
+        if (draw)
+        {
+            DrawFrame();
+            t = TimePhase(TIMING_DRAW, t);
+        }
+    }
+    if (draw)
+    {
+        OSDdraw();
+        t = TimePhase(TIMING_OSD, t);
+        Flip();
+        t = TimePhase(TIMING_FLIP, t);
+        pacer_stats.drawn++;
+    }
+    pacer_stats.frames++;
+    Trace_Span(draw ? "frame" : "skipped frame", start, t, "frame", (int)pacer_stats.frames, 0);
+
+    if (++timing_frames == TIMING_WINDOW)
+    {
+        SDL_memcpy(timing_stats.last, timing_window, sizeof(timing_window));
+        SDL_memset(timing_window, 0, sizeof(timing_window));
+        timing_frames = 0;
+    }
+
+    if (golden && !Golden_Frame(screen))
+    {
+        return SDL_APP_FAILURE;
+    }
+
+    return SDL_APP_CONTINUE;
+}
+
+// Runs the game at PACER_HZ from the time passed, whatever the display
+// refresh.  Behind by more than a frame, frames are run without drawing
+// them, up to PACER_MAX_SKIP in a row; past that the rest of the time owed
+// is given up, and the game slows down instead.  Ahead, it sleeps.
+SDL_AppResult Iterate()
+{
+    const bool*   kbstate = SDL_GetKeyboardState(NULL);
+    const Uint64  frequency = SDL_GetPerformanceFrequency();
+    const Uint64  step = frequency / PACER_HZ;
+    const Uint64  now = SDL_GetPerformanceCounter();
+    SDL_AppResult result = SDL_APP_CONTINUE;
+    int           skipped;
+
+    // Golden images are compared frame by frame, so all are drawn, as
+    // fast as they go.
+    if (golden)
+    {
+        return Step(1);
+    }
+
+    if (kbstate[SDL_SCANCODE_0]) // Hold 0 to fast forward.
+    {
+        return Turbo(now);
+    }
+    if (turbo_start)
+    {
+        const TimingPhase* update = &timing_stats.session[TIMING_UPDATE];
+        const double       ms = (now - turbo_start) * 1000.0 / frequency;
+        const Uint64       updates = update->frames - turbo_update.frames;
+
+        OSDset("fast forward: %.0f frames/s", turbo_frames * 1000.0 / ms);
+        if (updates)
+        {
+            SDL_Log("fast forward: %u frames in %.0f ms, %.3f ms per update", (unsigned)turbo_frames, ms,
+                    (update->total - turbo_update.total) * 1000.0 / frequency / updates);
+        }
+        turbo_start = 0;
+    }
+
+    pace_lag += pace_last ? now - pace_last : step;
+    pace_last = now;
+    if (pace_lag < step)
+    {
+        SDL_DelayNS((step - pace_lag) * SDL_NS_PER_SECOND / frequency);
+        return SDL_APP_CONTINUE;
+    }
+
+    for (skipped = 0; pace_lag >= 2 * step && skipped < PACER_MAX_SKIP && result == SDL_APP_CONTINUE; skipped++)
+    {
+        result = Step(0);
+        pace_lag -= step;
+    }
+    pacer_stats.skipped += skipped;
+    if (pace_lag >= 2 * step)
+    {
+        pacer_stats.late++;
+        pacer_stats.lost += pace_lag / step - 1;
+        pace_lag = step + pace_lag % step;
+    }
+    if (result == SDL_APP_CONTINUE)
+    {
+        result = Step(1);
+        pace_lag -= step;
+    }
+
+    return result;
+}
+
+// Runs TURBO_FRAMES frames and draws the last, as fast as the display
+// takes them.  Sounds of the frames not drawn are left out, they would
+// all play at once.  The time owed by the pacer starts over afterwards.
+static SDL_AppResult Turbo(Uint64 now)
+{
+    SDL_AppResult result = SDL_APP_CONTINUE;
+    int           i;
+
+    if (!turbo_start)
+    {
+        turbo_start = now;
+        turbo_frames = 0;
+        turbo_update = timing_stats.session[TIMING_UPDATE];
+    }
+
+    quiet = 1;
+    for (i = 1; i < TURBO_FRAMES && result == SDL_APP_CONTINUE; i++)
+    {
+        result = Step(0);
+    }
+    quiet = 0;
+    if (result == SDL_APP_CONTINUE)
+    {
+        result = Step(1);
+    }
+    pacer_stats.turbo += i - 1;
+    turbo_frames += i;
+
+    pace_last = SDL_GetPerformanceCounter();
+    pace_lag = 0;
+    return result;
+}
+
+int StartGolden(const char* replay_path, const char* path, int record)
+{
+    Replay_Header header;
+
+    if (!initial_game_state || !Replay_Load(replay_path, &header))
+    {
+        return false;
+    }
+    if (!(record ? Golden_StartRecording(screen->w, screen->h) : Golden_StartChecking(path, p8_palette)))
+    {
+        Replay_Stop();
+        return false;
     }
-    OSDdraw();
-    Flip();
+    ResetGame(header.seed);
+    replaying = 1;
+    golden = 1;
+    golden_recording = record;
+    SDL_strlcpy(golden_path, path, sizeof(golden_path));
+    if (Replay_HashState() != header.initial_hash)
+    {
+        SDL_Log("%s was recorded by another build", replay_path);
+    }
+    SDL_Log("%s golden images of %s", record ? "recording" : "checking", replay_path);
 
     return true;
 }
 
 void Destroy()
 {
+    if (upload_stats.frames)
+    {
+        SDL_Log("texture upload: %.1f bytes/frame of %d", (double)upload_stats.total / upload_stats.frames,
+                PICO8_W * PICO8_H * resolve.bpp);
+    }
+    if (pacer_stats.frames)
+    {
+        SDL_Log("pacer: %u frames, %u drawn, %u skipped, %u late, %u frames behind, %u fast forwarded",
+                (unsigned)pacer_stats.frames, (unsigned)pacer_stats.drawn, (unsigned)pacer_stats.skipped,
+                (unsigned)pacer_stats.late, (unsigned)pacer_stats.lost, (unsigned)pacer_stats.turbo);
+    }
+    for (int i = 0; i < TIMING_PHASES; i++)
+    {
+        const TimingPhase* phase = &timing_stats.session[i];
+        const double       ms = 1000.0 / SDL_GetPerformanceFrequency();
+
+        if (phase->frames)
+        {
+            SDL_Log("timing %s: %.3f min, %.3f avg, %.3f max ms over %u frames", timing_names[i], phase->min * ms,
+                    phase->total * ms / phase->frames, phase->max * ms, (unsigned)phase->frames);
+        }
+    }
+
+    Rewind_Destroy();
+    Golden_Stop();
+#ifdef CELESTE_TRACE
+    {
+        char path[256];
+
+        TracePath(path, sizeof(path));
+        Trace_Save(path);
+    }
+#endif
+    Trace_Destroy();
+
     if (game_state)
     {
         SDL_free(game_state);
@@ -368,31 +756,42 @@ void Destroy()
     {
         SDL_free(initial_game_state);
     }
-    if (gfx)
-    {
-        SDL_DestroySurface(gfx);
-    }
-    if (font)
+    if (map_cache_stats.hits + map_cache_stats.misses)
     {
-        // This causes a crash. Why?!
-        //SDL_DestroySurface(font);
+        SDL_Log("map cache: %d layers in %u bytes, %.1f%% hits", map_cache_stats.layers, (unsigned)map_cache_stats.bytes,
+                100.0 * map_cache_stats.hits / (map_cache_stats.hits + map_cache_stats.misses));
     }
+
+    FreeMapLayers();
+    Sprite_DestroySheet(&gfx);
+    Sprite_DestroySheet(&font);
     if (frame)
     {
         SDL_DestroyTexture(frame);
     }
+    if (screen)
+    {
+        SDL_DestroySurface(screen);
+    }
+    if (canvas)
+    {
+        SDL_DestroySurface(canvas);
+    }
     if (SDL_screen)
     {
         SDL_DestroyTexture(SDL_screen);
     }
 
-    for (int i = 0; i < (sizeof(snd)) / (sizeof(*snd)); i++)
+    if (sound_cache_stats.hits + sound_cache_stats.misses)
     {
-        if (snd[i])
+        SDL_Log("sound cache: %d sounds in %u bytes, %.1f%% hits", sound_cache_stats.sounds, (unsigned)sound_cache_stats.bytes,
+                100.0 * sound_cache_stats.hits / (sound_cache_stats.hits + sound_cache_stats.misses));
+        if (sound_cache_stats.bundled)
         {
-            Mix_FreeChunk(snd[i]);
+            SDL_Log("sound cache: playing from the bundle, which holds %u bytes of samples", (unsigned)sound_cache_stats.bundled);
         }
     }
+    FreeSounds();
 #if ENABLE_MUSIC
     for (int i = 0; i < (sizeof(mus)) / (sizeof(*mus)); i++)
     {
@@ -405,607 +804,758 @@ void Destroy()
 
     Mix_CloseAudio();
     Mix_Quit();
+    Bundle_Free(&bundle);
 }
 
-static void Flip()
+void GetUploadStats(UploadStats* stats)
 {
-    SDL_FRect source = { 0.f, 0.f, 128.f, 128.f };
-    SDL_FRect dest = { 24.f, 25.f, 128.f, 128.f };
+    SDL_assert(stats != NULL);
+    *stats = upload_stats;
+}
 
-    SDL_UpdateTexture(SDL_screen, NULL, screen->pixels, screen->pitch);
-    SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
+void GetMapCacheStats(MapCacheStats* stats)
+{
+    SDL_assert(stats != NULL);
+    *stats = map_cache_stats;
+}
 
-    SDL_RenderTexture(renderer, SDL_screen, &source, &dest);
-    SDL_RenderPresent(renderer);
+void GetSoundCacheStats(SoundCacheStats* stats)
+{
+    SDL_assert(stats != NULL);
+    *stats = sound_cache_stats;
 }
 
-static void LoadData(void)
+void GetPacerStats(PacerStats* stats)
 {
-    static const char sndids[] = { 0,1,2,3,4,5,6,7,8,9,13,14,15,16,23,35,37,38,40,50,51,54,55 };
-    int iid;
-#ifdef ENABLE_MUSIC
-    static const char musids[] = { 0,10,20,30,40 };
-#endif
-    LOGLOAD("gfx.bmp");
-    loadbmpscale("gfx.bmp", &gfx);
-    LOGDONE();
+    SDL_assert(stats != NULL);
+    *stats = pacer_stats;
+}
 
-    LOGLOAD("font.bmp");
-    loadbmpscale("font.bmp", &font);
-    LOGDONE();
+void GetTimingStats(TimingStats* stats)
+{
+    SDL_assert(stats != NULL);
+    *stats = timing_stats;
+}
+
+// Coordinates should be scaled already.
+static void Damage(int x, int y, int w, int h)
+{
+    SDL_Rect rect = { x, y, w, h };
+    SDL_Rect bounds = { 0, 0, screen->w, screen->h };
+    int i;
 
-    for (iid = 0; iid < sizeof(sndids); iid++)
+    if (!SDL_GetRectIntersection(&rect, &bounds, &rect))
     {
-        int  id = sndids[iid];
-        char fname[20];
-        char path[256];
+        return;
+    }
+    for (i = 0; i < dirty_count; i++)
+    {
+        const SDL_Rect* d = &dirty[i];
 
-        SDL_snprintf(fname, 20, "snd%i.wav", id);
-        LOGLOAD(fname);
-        SDL_snprintf(path, 256, "%sdata/%s", SDL_GetBasePath(), fname);
-        snd[id] = Mix_LoadWAV(path);
-        if (!snd[id])
+        // Most frames start by clearing the screen, which covers everything else.
+        if (rect.x >= d->x && rect.y >= d->y && rect.x + rect.w <= d->x + d->w && rect.y + rect.h <= d->y + d->h)
         {
-            SDL_Log("snd%i: Mix_LoadWAV: %s", id, SDL_GetError());
+            return;
         }
-        LOGDONE();
     }
-
-#if ENABLE_MUSIC
-    for (iid = 0; iid < sizeof(musids); iid++)
+    if (dirty_count == DIRTY_MAX)
     {
-        int  id = musids[iid];
-        char fname[20];
-        char path[256];
-
-        SDL_snprintf(fname, 20, "mus%i.ogg", id);
-        LOGLOAD(fname);
-        SDL_snprintf(path, 256, "%s%s", SDL_GetBasePath(), fname);
-        mus[id / 10] = Mix_LoadMUS(path);
-        if (!mus[id / 10])
+        for (i = 1; i < dirty_count; i++)
         {
-            SDL_Log("mus%i: Mix_LoadMUS: %s", id, SDL_GetError());
+            SDL_GetRectUnion(&dirty[0], &dirty[i], &dirty[0]);
         }
-        LOGDONE();
+        dirty_count = 1;
     }
-#endif
+    dirty[dirty_count++] = rect;
 }
 
-static void SetPaletteEntry(unsigned char idx, unsigned char base_idx)
+static void FillRect(const SDL_Rect* rect, Uint32 color)
 {
-    palette_colors[idx] = base_palette_colors[base_idx];
-    map[idx] = SDL_MapSurfaceRGB(screen, palette_colors[idx].r, palette_colors[idx].g, palette_colors[idx].b);
+    SDL_FillSurfaceRect(screen, rect, color);
+    Damage(rect->x, rect->y, rect->w, rect->h);
 }
 
-static void RefreshPalette(void)
+// Merges rectangles wherever one upload is no bigger than the two, plus
+// a little slack to save on the cost of each upload.
+static void MergeDirty(void)
 {
-    for (int i = 0; i < SDL_arraysize(map); i++)
+    int i, j;
+
+    for (i = 0; i < dirty_count; i++)
     {
-        map[i] = SDL_MapSurfaceRGB(screen, palette_colors[i].r, palette_colors[i].g, palette_colors[i].b);
-    }
-}
+        for (j = i + 1; j < dirty_count; j++)
+        {
+            SDL_Rect both;
 
-static void ResetPalette(void)
-{
-    SDL_memcpy(palette_colors, base_palette_colors, sizeof(palette_colors));
-    RefreshPalette();
+            SDL_GetRectUnion(&dirty[i], &dirty[j], &both);
+            if (both.w * both.h <= dirty[i].w * dirty[i].h + dirty[j].w * dirty[j].h + DIRTY_SLACK)
+            {
+                dirty[i] = both;
+                dirty[j] = dirty[--dirty_count];
+                j = i; // Start over, the grown rectangle may reach others now.
+            }
+        }
+    }
 }
 
-static void OSDset(const char* fmt, ...)
+// The first of the renderer's texture formats there is a resolve kernel
+// for, XRGB4444 as on the N-Gage if it doesn't say.
+static SDL_PixelFormat ChooseFormat(void)
 {
-    va_list ap;
-    va_start(ap, fmt);
-    SDL_vsnprintf(osd_text, sizeof(osd_text), fmt, ap);
-    osd_text[sizeof(osd_text) - 1] = '\0'; // Make sure to add NUL terminator in case of truncation.
-    SDL_Log("%s", osd_text);
-    osd_timer = 30;
-    va_end(ap);
-}
+    const SDL_PixelFormat* formats;
 
-static void OSDdraw(void)
-{
-    if (osd_timer > 0)
+    formats = SDL_GetPointerProperty(SDL_GetRendererProperties(renderer), SDL_PROP_RENDERER_TEXTURE_FORMATS_POINTER, NULL);
+    for (int i = 0; formats && formats[i] != SDL_PIXELFORMAT_UNKNOWN; i++)
     {
-        --osd_timer;
+        if (Resolve_Supported(formats[i]))
+        {
+            return formats[i];
+        }
     }
+    return SDL_PIXELFORMAT_XRGB4444;
+}
 
-    if (osd_timer > 0)
+// Made by Init(), or with CELESTE_ZERO_COPY only once locking SDL_screen
+// has failed, so the zero-copy path doesn't keep a second screen around.
+static _Bool CreateCanvas(SDL_PixelFormat format)
+{
+    canvas = SDL_CreateSurface(PICO8_W, PICO8_H, format);
+    if (!canvas)
     {
-        const int x = 4;
-        const int y = 120 + (osd_timer < 10 ? 10 - osd_timer : 0); // Disappear by going below the screen.
-        p8_rectfill(x - 2, y - 2, x + 4 * (int)SDL_strlen(osd_text), y + 6, 6); // Outline.
-        p8_rectfill(x - 1, y - 1, x + 4 * (int)SDL_strlen(osd_text) - 1, y + 5, 0);
-        p8_print(osd_text, x, y, 7);
+        SDL_Log("SDL_CreateSurface: %s\n", SDL_GetError());
+        return false;
     }
+    return true;
 }
 
-static int pico8emu(CELESTE_P8_CALLBACK_TYPE call, ...)
+// Converts a rectangle of color indices to SDL_screen's pixel format.
+static void Resolve(const SDL_Rect* rect, void* pixels, int pitch)
 {
-    static int camera_x = 0, camera_y = 0;
-    va_list    args;
-    int        ret = 0;
-
-    if (!enable_screenshake)
-    {
-        camera_x = camera_y = 0;
-    }
+    const Uint8* src = (const Uint8*)screen->pixels + rect->y * screen->pitch + rect->x;
 
-    va_start(args, call);
+    Resolve_Rect(&resolve, src, screen->pitch, pixels, pitch, rect->w, rect->h);
+}
 
-#define INT_ARG() va_arg(args, int)
-#define BOOL_ARG() (Celeste_P8_bool_t)va_arg(args, int)
-#define RET_INT(_i)   do {ret = (_i); goto end;} while (0)
-#define RET_BOOL(_b) RET_INT(!!(_b))
+static void Flip()
+{
+    SDL_FRect source = { 0.f, 0.f, 128.f, 128.f };
+    SDL_FRect dest = { 24.f, 25.f, 128.f, 128.f };
+    int bpp = resolve.bpp;
+    int i;
 
-    switch (call)
+    MergeDirty();
+    upload_stats.last = 0;
+    for (i = 0; i < dirty_count; i++)
     {
-        case CELESTE_P8_MUSIC: //music(idx,fade,mask)
+        const SDL_Rect* rect = &dirty[i];
+        Uint8*          staged;
+
+        upload_stats.last += rect->w * rect->h * bpp;
+#ifdef CELESTE_ZERO_COPY
+        // Resolve straight into the texture.  The whole rectangle is
+        // written, so it doesn't matter what the locked memory held.
+        if (zero_copy)
         {
-#if ENABLE_MUSIC
-            int index = INT_ARG();
-            int fade = INT_ARG();
-            int mask = INT_ARG();
+            void* pixels;
+            int   pitch;
 
-            (void)mask; //we do not care about this since sdl mixer keeps sounds and music separate
-
-            if (index == -1) { //stop playing
-                Mix_FadeOutMusic(fade);
-                current_music = NULL;
-            }
-            else if (mus[index / 10])
+            if (SDL_LockTexture(SDL_screen, rect, &pixels, &pitch))
             {
-                Mix_Music* musi = mus[index / 10];
-                current_music = musi;
-                Mix_FadeInMusic(musi, -1, fade);
+                Resolve(rect, pixels, pitch);
+                SDL_UnlockTexture(SDL_screen);
+                continue;
             }
-#endif
-            break;
+            SDL_Log("SDL_LockTexture: %s, uploading from a surface instead", SDL_GetError());
+            zero_copy = 0;
         }
-        case CELESTE_P8_SPR: //spr(sprite,x,y,cols,rows,flipx,flipy)
+        if (!canvas && !CreateCanvas(resolve.format))
         {
-            int sprite = INT_ARG();
-            int x = INT_ARG();
-            int y = INT_ARG();
-            int cols = INT_ARG();
-            int rows = INT_ARG();
-            int flipx = BOOL_ARG();
-            int flipy = BOOL_ARG();
-
-            (void)cols;
-            (void)rows;
-
-            SDL_assert(rows == 1 && cols == 1);
-
-            if (sprite >= 0)
-            {
-                SDL_Rect srcrc =
-                {
-                    8 * (sprite % 16),
-                    8 * (sprite / 16)
-                };
-                SDL_Rect dstrc =
-                {
-                    (x - camera_x) * SCALE, (y - camera_y) * SCALE,
-                    SCALE, SCALE
-                };
-                srcrc.x *= SCALE;
-                srcrc.y *= SCALE;
-                srcrc.w = srcrc.h = SCALE * 8;
-                Xblit(gfx, &srcrc, screen, &dstrc, 0, flipx, flipy);
-            }
-            break;
-        }
-        case CELESTE_P8_BTN: //btn(b)
-        {
-            int b = INT_ARG();
-            SDL_assert(b >= 0 && b <= 5);
-            RET_BOOL(buttons_state & (1 << b));
             break;
         }
-        case CELESTE_P8_SFX: //sfx(id)
-        {
-            int id = INT_ARG();
+#endif
+        staged = (Uint8*)canvas->pixels + rect->y * canvas->pitch + rect->x * bpp;
+        Resolve(rect, staged, canvas->pitch);
+        SDL_UpdateTexture(SDL_screen, rect, staged, canvas->pitch);
+    }
+    upload_stats.total += upload_stats.last;
+    upload_stats.frames++;
+    dirty_count = 0;
 
-            if (id < (sizeof(snd)) / (sizeof(*snd)) && snd[id])
-            {
-                Mix_PlayChannel(-1, snd[id], 0);
-            }
-            break;
-        }
-        case CELESTE_P8_PAL: //pal(a,b)
+    SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
+
+    SDL_RenderTexture(renderer, SDL_screen, &source, &dest);
+    if (show_timing)
+    {
+        DrawTiming(dest.y + dest.h);
+    }
+    SDL_RenderPresent(renderer);
+    if (upload_stats.frames == 1)
+    {
+        SDL_Log("first frame %.1f ms after SDL_Init", SDL_GetTicksNS() / 1e6);
+    }
+}
+
+static void AddTiming(TimingPhase* phase, Uint64 ticks)
+{
+    if (!phase->frames || ticks < phase->min)
+    {
+        phase->min = ticks;
+    }
+    if (ticks > phase->max)
+    {
+        phase->max = ticks;
+    }
+    phase->total += ticks;
+    phase->frames++;
+}
+
+// Counts the time since start towards phase, and returns the time now to
+// start the next one from.
+static Uint64 TimePhase(int phase, Uint64 start)
+{
+    Uint64 now = SDL_GetPerformanceCounter();
+
+    AddTiming(&timing_window[phase], now - start);
+    AddTiming(&timing_stats.session[phase], now - start);
+    Trace_Span(trace_names[phase], start, now, NULL, 0, 0);
+    return now;
+}
+
+// Min, avg and max ms per phase over the last window, a line each in the
+// 8x8 debug font, on the border below the game from top.
+static void DrawTiming(float top)
+{
+    const double ms = 1000.0 / SDL_GetPerformanceFrequency();
+    SDL_FRect    strip = { 0.f, top, (float)NGAGE_W, NGAGE_H - top };
+    char         line[32];
+
+    SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
+    SDL_RenderFillRect(renderer, &strip);
+    SDL_SetRenderDrawColor(renderer, 255, 241, 232, 255);
+    for (int i = 0; i < TIMING_PHASES; i++)
+    {
+        const TimingPhase* phase = &timing_stats.last[i];
+
+        if (phase->frames)
         {
-            int a = INT_ARG();
-            int b = INT_ARG();
-            if (a >= 0 && a < 16 && b >= 0 && b < 16)
-            {
-                // Swap palette colors.
-                SetPaletteEntry(a, b);
-            }
-            break;
+            SDL_snprintf(line, sizeof(line), "%s%6.2f%6.2f%6.2f", timing_names[i], phase->min * ms,
+                         phase->total * ms / phase->frames, phase->max * ms);
         }
-        case CELESTE_P8_PAL_RESET: //pal()
+        else
         {
-            ResetPalette();
-            break;
+            SDL_snprintf(line, sizeof(line), "%s     -", timing_names[i]);
         }
-        case CELESTE_P8_CIRCFILL: //circfill(x,y,r,col)
-        {
-            int cx = INT_ARG() - camera_x;
-            int cy = INT_ARG() - camera_y;
-            int r = INT_ARG();
-            int col = INT_ARG();
-            int realcolor = getcolor(col);
+        SDL_RenderDebugText(renderer, 4.f, top + 3.f + 8.f * i, line);
+    }
+    SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
+}
 
-            if (r <= 1)
-            {
-                SDL_Rect rect_a = { SCALE * (cx - 1), SCALE * cy, SCALE * 3, SCALE };
-                SDL_Rect rect_b = { SCALE * cx, SCALE * (cy - 1), SCALE, SCALE * 3 };
+// Starts over from the title screen, as if the game had just been launched.
+static void ResetGame(unsigned seed)
+{
+    paused = 0;
+    Celeste_P8_load_state(initial_game_state);
+    Celeste_P8_set_rndseed(seed);
+    Mix_HaltChannel(-1);
+#if ENABLE_MUSIC
+    Mix_HaltMusic();
+    current_music = NULL;
+#endif
+    Celeste_P8_init();
+    Rewind_Clear();
+    recording = replaying = 0; // The replay stays loaded, to be played from the start.
+}
 
-                SDL_FillSurfaceRect(screen, &rect_a, realcolor);
-                SDL_FillSurfaceRect(screen, &rect_b, realcolor);
-            }
-            else if (r <= 2)
-            {
-                SDL_Rect rect_a = { SCALE * (cx - 2), SCALE * (cy - 1), SCALE * 5, SCALE * 3 };
-                SDL_Rect rect_b = { SCALE * (cx - 1), SCALE * (cy - 2), SCALE * 3, SCALE * 5 };
+// With CELESTE_DRAW_LIST, the core only lists the frame's drawing and
+// pico8emu renders it afterwards in one pass.
+static void DrawFrame(void)
+{
+    Celeste_P8_draw();
+#ifdef CELESTE_DRAW_LIST
+    Celeste_P8_run_draw_list(&draw_list, &pico8emu);
+#endif
+}
 
-                SDL_FillSurfaceRect(screen, &rect_a, realcolor);
-                SDL_FillSurfaceRect(screen, &rect_b, realcolor);
-            }
-            else if (r <= 3)
-            {
-                SDL_Rect rect_a = { SCALE * (cx - 3), SCALE * (cy - 1), SCALE * 7, SCALE * 3 };
-                SDL_Rect rect_b = { SCALE * (cx - 1), SCALE * (cy - 3), SCALE * 3, SCALE * 7 };
-                SDL_Rect rect_c = { SCALE * (cx - 2), SCALE * (cy - 2), SCALE * 5, SCALE * 5 };
+static void ReplayPath(char* path, size_t size)
+{
+    SDL_snprintf(path, size, "%sceleste.rpl", SDL_GetUserFolder(SDL_FOLDER_SAVEDGAMES));
+}
 
-                SDL_FillSurfaceRect(screen, &rect_a, realcolor);
-                SDL_FillSurfaceRect(screen, &rect_b, realcolor);
-                SDL_FillSurfaceRect(screen, &rect_c, realcolor);
-            }
-            else  // I dont think the game uses this.
-            {
-                int f = 1 - r; // Used to track the progress of the drawn circle (since its semi-recursive).
-                int ddFx = 1;   // Step x.
-                int ddFy = -2 * r; // Step y.
-                int x = 0;
-                int y = r;
-
-                // This algorithm doesn't account for the diameters
-                // so we have to set them manually
-                p8_line(cx, cy - y, cx, cy + r, col);
-                p8_line(cx + r, cy, cx - r, cy, col);
-
-                while (x < y)
-                {
-                    if (f >= 0)
-                    {
-                        y--;
-                        ddFy += 2;
-                        f += ddFy;
-                    }
-                    x++;
-                    ddFx += 2;
-                    f += ddFx;
-
-                    // Build our current arc.
-                    p8_line(cx + x, cy + y, cx - x, cy + y, col);
-                    p8_line(cx + x, cy - y, cx - x, cy - y, col);
-                    p8_line(cx + y, cy + x, cx - y, cy + x, col);
-                    p8_line(cx + y, cy - x, cx - y, cy - x, col);
-                }
-            }
-            break;
-        }
-        case CELESTE_P8_PRINT: //print(str,x,y,col)
-        {
-            const char* str = va_arg(args, const char*);
-            int x = INT_ARG() - camera_x;
-            int y = INT_ARG() - camera_y;
-            int col = INT_ARG() % 16;
+#ifdef CELESTE_TRACE
+static void TracePath(char* path, size_t size)
+{
+    SDL_snprintf(path, size, "%sceleste.json", SDL_GetUserFolder(SDL_FOLDER_SAVEDGAMES));
+}
+#endif
 
-            p8_print(str, x, y, col);
-            break;
-        }
-        case CELESTE_P8_RECTFILL: //rectfill(x0,y0,x1,y1,col)
-        {
-            int x0 = INT_ARG() - camera_x;
-            int y0 = INT_ARG() - camera_y;
-            int x1 = INT_ARG() - camera_x;
-            int y1 = INT_ARG() - camera_y;
-            int col = INT_ARG();
+static void LoadData(void)
+{
+    static const int pinned[] = SOUND_CACHE_PINNED;
+    int iid;
+#ifdef ENABLE_MUSIC
+    static const char musids[] = { 0,10,20,30,40 };
+#endif
+    Uint64 start = SDL_GetTicksNS();
+    char bundle_path[256];
 
-            p8_rectfill(x0, y0, x1, y1, col);
-            break;
-        }
-        case CELESTE_P8_LINE: // line(x0,y0,x1,y1,col)
+    SDL_snprintf(bundle_path, sizeof(bundle_path), "%sdata/%s", SDL_GetBasePath(), BUNDLE_NAME);
+    if (!Bundle_Load(&bundle, bundle_path))
+    {
+        SDL_Log("loading the data files instead");
+    }
+    for (iid = 0; iid < bundle.count; iid++)
+    {
+        if (bundle.entries[iid].kind == BUNDLE_PCM)
         {
-            int x0 = INT_ARG() - camera_x;
-            int y0 = INT_ARG() - camera_y;
-            int x1 = INT_ARG() - camera_x;
-            int y1 = INT_ARG() - camera_y;
-            int col = INT_ARG();
-
-            p8_line(x0, y0, x1, y1, col);
-            break;
+            sound_cache_stats.bundled += bundle.entries[iid].size;
         }
-        case CELESTE_P8_MGET: // mget(tx,ty)
-        {
-            int tx = INT_ARG();
-            int ty = INT_ARG();
+    }
 
-            RET_INT(tilemap_data[tx + ty * 128]);
-            break;
-        }
-        case CELESTE_P8_CAMERA: //camera(x,y)
+    LOGLOAD("gfx.bmp");
+    loadbmpscale("gfx.bmp", &gfx, SPRITE_FLIP_X);
+    LOGDONE();
+
+    LOGLOAD("font.bmp");
+    loadbmpscale("font.bmp", &font, SPRITE_SHAPE);
+    LOGDONE();
+
+    // The rest of the sounds are loaded when first played.
+    for (iid = 0; iid < SDL_arraysize(pinned); iid++)
+    {
+        int  id = pinned[iid];
+        char fname[20];
+
+        SDL_snprintf(fname, 20, "snd%i.wav", id);
+        LOGLOAD(fname);
+        sounds[id].pinned = 1;
+        CacheSound(id);
+        LOGDONE();
+    }
+
+#if ENABLE_MUSIC
+    for (iid = 0; iid < sizeof(musids); iid++)
+    {
+        int  id = musids[iid];
+        char fname[20];
+        char path[256];
+
+        SDL_snprintf(fname, 20, "mus%i.ogg", id);
+        LOGLOAD(fname);
+        SDL_snprintf(path, 256, "%s%s", SDL_GetBasePath(), fname);
+        mus[id / 10] = Mix_LoadMUS(path);
+        if (!mus[id / 10])
         {
-            if (enable_screenshake)
-            {
-                camera_x = INT_ARG();
-                camera_y = INT_ARG();
-            }
-            break;
+            SDL_Log("mus%i: Mix_LoadMUS: %s", id, SDL_GetError());
         }
-        case CELESTE_P8_FGET: //fget(tile,flag)
-        {
-            int tile = INT_ARG();
-            int flag = INT_ARG();
+        LOGDONE();
+    }
+#endif
 
-            RET_INT(gettileflag(tile, flag));
-            break;
-        }
-        case CELESTE_P8_MAP: //map(mx,my,tx,ty,mw,mh,mask)
-        {
-            int mx = INT_ARG(), my = INT_ARG();
-            int tx = INT_ARG(), ty = INT_ARG();
-            int mw = INT_ARG(), mh = INT_ARG();
-            int mask = INT_ARG();
-            int x, y;
+    SDL_Log("data loaded in %.1f ms from %s", (SDL_GetTicksNS() - start) / 1e6, bundle.blob ? BUNDLE_NAME : "data files");
+}
 
-            for (x = 0; x < mw; x++)
-            {
-                for (y = 0; y < mh; y++)
-                {
-                    int tile = tilemap_data[x + mx + (y + my) * 128];
-                    // Hack.
-                    if (mask == 0 || (mask == 4 && tile_flags[tile] == 4) || gettileflag(tile, mask != 4 ? mask - 1 : mask))
-                    {
-                        SDL_Rect srcrc =
-                        {
-                        8 * (tile % 16),
-                        8 * (tile / 16)
-                        };
-                        SDL_Rect dstrc =
-                        {
-                        (tx + x * 8 - camera_x) * SCALE, (ty + y * 8 - camera_y) * SCALE,
-                        SCALE * 8, SCALE * 8
-                        };
-                        srcrc.x *= SCALE;
-                        srcrc.y *= SCALE;
-                        srcrc.w = srcrc.h = SCALE * 8;
-
-                        Xblit(gfx, &srcrc, screen, &dstrc, 0, 0, 0);
-                    }
-                }
-            }
-            break;
-        }
+static void SetPaletteEntry(unsigned char idx, unsigned char base_idx)
+{
+    draw_palette[idx] = base_idx;
+    draw_palette_set = 0;
+    for (int i = 0; i < SDL_arraysize(draw_palette); i++)
+    {
+        draw_palette_set |= draw_palette[i] != i;
+    }
+}
+
+static int RefreshPalette(SDL_PixelFormat format)
+{
+    return Resolve_Init(&resolve, format, p8_palette);
+}
+
+static void ResetPalette(void)
+{
+    for (int i = 0; i < SDL_arraysize(draw_palette); i++)
+    {
+        draw_palette[i] = (Uint8)i;
+    }
+    draw_palette_set = 0;
+}
+
+static void OSDset(const char* fmt, ...)
+{
+    va_list ap;
+    va_start(ap, fmt);
+    SDL_vsnprintf(osd_text, sizeof(osd_text), fmt, ap);
+    osd_text[sizeof(osd_text) - 1] = '\0'; // Make sure to add NUL terminator in case of truncation.
+    SDL_Log("%s", osd_text);
+    osd_timer = 30;
+    va_end(ap);
+}
+
+static void OSDdraw(void)
+{
+    if (osd_timer > 0)
+    {
+        --osd_timer;
+    }
+
+    if (osd_timer > 0)
+    {
+        const int x = 4;
+        const int y = 120 + (osd_timer < 10 ? 10 - osd_timer : 0); // Disappear by going below the screen.
+        p8_rectfill(x - 2, y - 2, x + 4 * (int)SDL_strlen(osd_text), y + 6, 6); // Outline.
+        p8_rectfill(x - 1, y - 1, x + 4 * (int)SDL_strlen(osd_text) - 1, y + 5, 0);
+        p8_print(osd_text, x, y, 7);
     }
+}
+
+static void emu_music(int index, int fade, int mask) //music(idx,fade,mask)
+{
+    (void)mask; //we do not care about this since sdl mixer keeps sounds and music separate
 
-end:
-    va_end(args);
-    return ret;
+#if ENABLE_MUSIC
+    if (index == -1) { //stop playing
+        Mix_FadeOutMusic(fade);
+        current_music = NULL;
+    }
+    else if (mus[index / 10])
+    {
+        Mix_Music* musi = mus[index / 10];
+        current_music = musi;
+        Mix_FadeInMusic(musi, -1, fade);
+    }
+#else
+    (void)index;
+    (void)fade;
+#endif
 }
 
-static Uint32 getpixel(SDL_Surface* surface, int x, int y)
+static void emu_spr(int sprite, int x, int y, int cols, int rows, Celeste_P8_bool_t flipx, Celeste_P8_bool_t flipy) //spr(sprite,x,y,cols,rows,flipx,flipy)
 {
-    int bpp = SDL_BYTESPERPIXEL(surface->format);
-    /* Here p is the address to the pixel we want to retrieve */
-    Uint8* p = (Uint8*)surface->pixels + y * surface->pitch + x * bpp;
+    (void)cols;
+    (void)rows;
+
+    SDL_assert(rows == 1 && cols == 1);
 
-    if (bpp == 2) // RGB565.
+    if (sprite >= 0)
     {
-        Uint16 pixel = *(Uint16*)p;
+        Blit(&gfx, sprite, (x - camera_x) * SCALE, (y - camera_y) * SCALE, -1,
+             (flipx ? SPRITE_FLIP_X : 0) | (flipy ? SPRITE_FLIP_Y : 0));
+    }
+}
 
-        // Extract RGB565 channels.
-        Uint8 r5 = (pixel >> 11) & 0x1F; // 5 bits for red.
-        Uint8 g6 = (pixel >> 5) & 0x3F;  // 6 bits for green.
-        Uint8 b5 = pixel & 0x1F;         // 5 bits for blue.
+static Celeste_P8_bool_t emu_btn(int b) //btn(b)
+{
+    SDL_assert(b >= 0 && b <= 5);
+    return !!(buttons_state & (1 << b));
+}
 
-        // Scale to 4 bits for XRGB4444.
-        Uint8 r4 = (r5 * 15) / 31;
-        Uint8 g4 = (g6 * 15) / 63;
-        Uint8 b4 = (b5 * 15) / 31;
+static void emu_sfx(int id) //sfx(id)
+{
+    Sound* sound;
 
-        Uint8 a4;
-        Uint32 key;
-        SDL_GetSurfaceColorKey(surface, &key);
-        if (pixel == key)
-        {
-            a4 = 0;
-        }
-        else
-        {
-            // Set alpha to 15 (fully opaque).
-            a4 = 15;
-        }
+    if (id >= SDL_arraysize(sounds) || quiet)
+    {
+        return;
+    }
+    sound = &sounds[id];
+    Trace_Instant("sfx", "id", id, 0);
+    if (sound->chunk)
+    {
+        sound_cache_stats.hits++;
+    }
+    else if (!sound->failed)
+    {
+        sound_cache_stats.misses++;
+        CacheSound(id);
+    }
+    if (sound->chunk)
+    {
+        sound->used = ++sound_cache_clock;
+        Mix_PlayChannel(-1, sound->chunk, 0);
+    }
+}
 
-        // Combine into ARGB4444.
-        return (a4 << 12) | (r4 << 8) | (g4 << 4) | b4;
+#ifdef CELESTE_TRACE
+static void emu_trace(CELESTE_P8_TRACE_TYPE type, int a, int b)
+{
+    switch (type)
+    {
+        case CELESTE_P8_TRACE_LOAD_ROOM:      Trace_Instant("load_room", "x,y", a, b); break;
+        case CELESTE_P8_TRACE_INIT_OBJECT:    Trace_Instant("init_object", "type,id", a, b); break;
+        case CELESTE_P8_TRACE_DESTROY_OBJECT: Trace_Instant("destroy_object", "type,id", a, b); break;
     }
-    else if (bpp == 4) // ARGB8888, passthrough.
+}
+#endif
+
+static void emu_pal(int a, int b) //pal(a,b)
+{
+    if (a >= 0 && a < 16 && b >= 0 && b < 16)
     {
-        return *(Uint32*)p;
+        // Swap palette colors.
+        SetPaletteEntry(a, b);
     }
-    else // Unsupported format.
+}
+
+static void emu_pal_reset(void) //pal()
+{
+    ResetPalette();
+}
+
+static void emu_circfill(int x, int y, int r, int col) //circfill(x,y,r,col)
+{
+    SDL_Rect drawn;
+
+    if (Raster_Circfill(screen, SCALE, x - camera_x, y - camera_y, r, getcolor(col), &drawn))
     {
-        return 0;
+        Damage(drawn.x, drawn.y, drawn.w, drawn.h);
     }
 }
 
-static int gettileflag(int tile, int flag)
+static void emu_print(const char* str, int x, int y, int col) //print(str,x,y,col)
 {
-    return tile < sizeof(tile_flags) / sizeof(*tile_flags) && (tile_flags[tile] & (1 << flag)) != 0;
+    p8_print(str, x - camera_x, y - camera_y, col % 16);
 }
 
-static void loadbmpscale(char* filename, SDL_Surface** s)
+static void emu_rectfill(int x0, int y0, int x1, int y1, int col) //rectfill(x0,y0,x1,y1,col)
 {
-    SDL_Surface* surf = *s;
-    char tmpath[256];
-    SDL_Surface* bmp;
-    int w, h;
-    Uint16* data;
+    p8_rectfill(x0 - camera_x, y0 - camera_y, x1 - camera_x, y1 - camera_y, col);
+}
+
+static void emu_line(int x0, int y0, int x1, int y1, int col) // line(x0,y0,x1,y1,col)
+{
+    p8_line(x0 - camera_x, y0 - camera_y, x1 - camera_x, y1 - camera_y, col);
+}
 
-    if (surf)
+static int emu_mget(int tx, int ty) // mget(tx,ty)
+{
+    return tilemap_data[tx + ty * 128];
+}
+
+static void emu_camera(int x, int y) //camera(x,y)
+{
+    if (enable_screenshake)
     {
-        SDL_DestroySurface(surf), surf = *s = NULL;
+        camera_x = x;
+        camera_y = y;
     }
+}
 
-    SDL_snprintf(tmpath, sizeof(tmpath), "%sdata/%s", SDL_GetBasePath(), filename);
+static Celeste_P8_bool_t emu_fget(int tile, int flag) //fget(tile,flag)
+{
+    return gettileflag(tile, flag);
+}
 
-    bmp = SDL_LoadBMP(tmpath);
-    if (!bmp)
+static void emu_map(int mx, int my, int tx, int ty, int mw, int mh, int mask) //map(mx,my,tx,ty,mw,mh,mask)
+{
+    int x, y;
+
+    if (mw == mh && DrawMapLayer(mx, my, tx, ty, mw, mask))
     {
-        SDL_Log("Error loading bmp '%s': %s", filename, SDL_GetError());
         return;
     }
 
-    w = bmp->w;
-    h = bmp->h;
-
-    surf = SDL_CreateSurface(w * SCALE, h * SCALE, screen->format);
-    SDL_assert(surf != NULL);
-    data = (Uint16*)surf->pixels;
-    for (int y = 0; y < h; y++)
+    for (x = 0; x < mw; x++)
     {
-        for (int x = 0; x < w; x++)
+        for (y = 0; y < mh; y++)
         {
-            Uint16 pix = (Uint16)getpixel(bmp, x, y);
-            for (int i = 0; i < SCALE; i++)
+            int tile = tilemap_data[x + mx + (y + my) * 128];
+            if (maptileshown(tile, mask))
             {
-                for (int j = 0; j < SCALE; j++)
-                {
-                    data[(x * SCALE + i) + (y * SCALE + j) * w * SCALE] = pix;
-                }
+                Blit(&gfx, tile, (tx + x * 8 - camera_x) * SCALE, (ty + y * 8 - camera_y) * SCALE, -1, 0);
             }
         }
     }
-    SDL_DestroySurface(bmp);
+}
 
-    palette.colors = palette_colors;
-    palette.ncolors = 16;
+static const struct Celeste_P8_backend pico8emu =
+{
+    emu_music, emu_spr, emu_btn, emu_sfx,
+    emu_pal, emu_pal_reset, emu_circfill, emu_print,
+    emu_rectfill, emu_line, emu_mget, emu_camera,
+    emu_fget, emu_map
+};
 
-    SDL_SetSurfacePalette(surf, &palette);
-    SDL_SetSurfaceColorKey(surf, true, 0);
+static int gettileflag(int tile, int flag)
+{
+    return tile < sizeof(tile_flags) / sizeof(*tile_flags) && (tile_flags[tile] & (1 << flag)) != 0;
+}
 
-    *s = surf;
+static int maptileshown(int tile, int mask)
+{
+    // Hack.
+    return mask == 0 || (mask == 4 && tile_flags[tile] == 4) || gettileflag(tile, mask != 4 ? mask - 1 : mask);
 }
 
-// Coordinates should NOT be scaled before calling this.
-static void p8_line(int x0, int y0, int x1, int y1, unsigned char color)
+static void loadbmpscale(char* filename, Sprite_Sheet* s, int flags)
 {
-    Uint32 realcolor = getcolor(color);
-    int sx, sy, dx, dy, err;
-    SDL_Rect rect;
-
-#define CLAMP(v,min,max) v = v < min ? min : v >= max ? max-1 : v;
-    CLAMP(x0, 0, screen->w);
-    CLAMP(y0, 0, screen->h);
-    CLAMP(x1, 0, screen->w);
-    CLAMP(y1, 0, screen->h);
-
-#undef CLAMP
-#define PLOT(xa, ya) \
-    rect.x = xa * SCALE; \
-    rect.y = ya * SCALE; \
-    rect.w = SCALE; \
-    rect.h = SCALE; \
-    do { \
-        SDL_FillSurfaceRect(screen, &rect, realcolor); \
-    } \
-    while (0)
-    dx = SDL_abs(x1 - x0);
-    dy = SDL_abs(y1 - y0);
-    if (!dx && !dy)
+    const Bundle_Entry* entry = Bundle_Find(&bundle, filename, BUNDLE_INDEXED);
+    char tmpath[256];
+    SDL_Surface* surf;
+
+    Sprite_DestroySheet(s);
+
+    if (entry)
+    {
+        surf = Sprite_CreateIndexed(entry->data, entry->width, entry->height, SCALE);
+    }
+    else
+    {
+        SDL_snprintf(tmpath, sizeof(tmpath), "%sdata/%s", SDL_GetBasePath(), filename);
+        surf = Sprite_LoadIndexed(tmpath, SCALE, p8_palette);
+    }
+    if (!surf)
     {
         return;
     }
+    Sprite_CreateSheet(s, surf, 8 * SCALE, flags);
+    SDL_DestroySurface(surf);
+}
 
-    if (x0 < x1)
+// A data file, from the bundle if it has the file as it is.
+static SDL_IOStream* OpenData(const char* name)
+{
+    const Bundle_Entry* entry = Bundle_Find(&bundle, name, BUNDLE_FILE);
+    char path[256];
+
+    if (entry)
     {
-        sx = 1;
+        return SDL_IOFromConstMem(entry->data, entry->size);
     }
-    else
+    SDL_snprintf(path, sizeof(path), "%sdata/%s", SDL_GetBasePath(), name);
+    return SDL_IOFromFile(path, "rb");
+}
+
+// Bundled sounds are played from the bundle's memory as they are, unless
+// the mixer was opened in another format.  pcm gets the converted samples
+// then, which the chunk doesn't free.
+static Mix_Chunk* LoadSound(const char* name, Uint8** pcm_out)
+{
+    const Bundle_Entry* entry = Bundle_Find(&bundle, name, BUNDLE_PCM);
+    SDL_AudioSpec pcm, mixer;
+    SDL_IOStream* io;
+    int len;
+
+    *pcm_out = NULL;
+    if (!entry)
     {
-        sx = -1;
+        io = OpenData(name);
+        return io ? Mix_LoadWAV_IO(io, true) : NULL;
     }
-    if (y0 < y1)
+
+    pcm.format = SDL_AUDIO_S16;
+    pcm.channels = 1;
+    pcm.freq = BUNDLE_PCM_RATE;
+    if (!Mix_QuerySpec(&mixer.freq, &mixer.format, &mixer.channels))
     {
-        sy = 1;
+        return NULL;
     }
-    else
+    if (mixer.format == pcm.format && mixer.channels == pcm.channels && mixer.freq == pcm.freq)
     {
-        sy = -1;
+        return Mix_QuickLoad_RAW(entry->data, (Uint32)entry->size);
     }
-    err = dx - dy;
-    if (!dy && !dx)
+    if (!SDL_ConvertAudioSamples(&pcm, entry->data, (int)entry->size, &mixer, pcm_out, &len))
     {
-        return;
+        return NULL;
     }
-    else if (!dx) //vertical line
+    return Mix_QuickLoad_RAW(*pcm_out, (Uint32)len);
+}
+
+static _Bool SoundPlaying(const Mix_Chunk* chunk)
+{
+    int channels = Mix_AllocateChannels(-1);
+
+    for (int i = 0; i < channels; i++)
     {
-        int y;
-        for (y = y0; y != y1; y += sy)
+        if (Mix_Playing(i) && Mix_GetChunk(i) == chunk)
         {
-            PLOT(x0, y);
+            return 1;
         }
     }
-    else if (!dy) //horizontal line
+    return 0;
+}
+
+static void FreeSound(Sound* sound)
+{
+    if (sound->chunk)
     {
-        int x;
-        for (x = x0; x != x1; x += sx)
-        {
-            PLOT(x, y0);
-        }
+        Mix_FreeChunk(sound->chunk);
+        sound_cache_stats.sounds--;
+        sound_cache_stats.bytes -= sound->bytes;
+    }
+    SDL_free(sound->pcm);
+    sound->chunk = NULL;
+    sound->pcm = NULL;
+    sound->bytes = 0;
+}
+
+// Loads sound id, then drops the least recently played sounds that aren't
+// pinned or playing until the cache is back within SOUND_CACHE_BUDGET.
+// A sound that can't be loaded isn't tried again.
+static int CacheSound(int id)
+{
+    Sound* sound = &sounds[id];
+    char   name[20];
+
+    SDL_snprintf(name, sizeof(name), "snd%i.wav", id);
+    sound->chunk = LoadSound(name, &sound->pcm);
+    if (!sound->chunk)
+    {
+        SDL_Log("snd%i: %s", id, SDL_GetError());
+        SDL_free(sound->pcm);
+        sound->pcm = NULL;
+        sound->failed = 1;
+        return false;
     }
+    sound->bytes = sound->chunk->allocated || sound->pcm ? sound->chunk->alen : 0;
+    sound->used = ++sound_cache_clock;
+    sound_cache_stats.sounds++;
+    sound_cache_stats.bytes += sound->bytes;
 
-    while (x0 != x1 || y0 != y1)
+    while (sound_cache_stats.bytes > SOUND_CACHE_BUDGET)
     {
-        int e2;
-        PLOT(x0, y0);
-        e2 = 2 * err;
-        if (e2 > -dy)
+        Sound* oldest = NULL;
+
+        for (int i = 0; i < SDL_arraysize(sounds); i++)
         {
-            err -= dy;
-            x0 += sx;
+            Sound* s = &sounds[i];
+
+            if (s->bytes && s != sound && !s->pinned && (!oldest || s->used < oldest->used) && !SoundPlaying(s->chunk))
+            {
+                oldest = s;
+            }
         }
-        if (e2 < dx)
+        if (!oldest)
         {
-            err += dx;
-            y0 += sy;
+            break;
         }
+        FreeSound(oldest);
+    }
+    return true;
+}
+
+static void FreeSounds(void)
+{
+    for (int i = 0; i < SDL_arraysize(sounds); i++)
+    {
+        FreeSound(&sounds[i]);
+    }
+}
+
+// Coordinates should NOT be scaled before calling this.
+static void p8_line(int x0, int y0, int x1, int y1, unsigned char color)
+{
+    SDL_Rect drawn;
+
+    if (Raster_Line(screen, SCALE, x0, y0, x1, y1, getcolor(color), &drawn))
+    {
+        Damage(drawn.x, drawn.y, drawn.w, drawn.h);
     }
-#undef PLOT
 }
 
 static void p8_print(const char* str, int x, int y, int col)
 {
     for (char c = *str; c; c = *(++str))
     {
-        SDL_Rect srcrc;
-        SDL_Rect dstrc;
         c &= 0x7F;
-        srcrc.x = 8 * (c % 16);
-        srcrc.y = 8 * (c / 16);
-        srcrc.x *= SCALE;
-        srcrc.y *= SCALE;
-        srcrc.w = srcrc.h = 8 * SCALE;
-
-        dstrc.x = x * SCALE;
-        dstrc.y = y * SCALE;
-        dstrc.w = SCALE;
-        dstrc.h = SCALE;
-
-        Xblit(font, &srcrc, screen, &dstrc, col, 0, 0);
+        Blit(&font, c, x * SCALE, y * SCALE, getcolor(col), 0);
         x += 4;
     }
 }
@@ -1017,111 +1567,141 @@ static void p8_rectfill(int x0, int y0, int x1, int y1, int col)
     if (w > 0 && h > 0)
     {
         SDL_Rect rc = { x0 * SCALE, y0 * SCALE, w, h };
-        SDL_FillSurfaceRect(screen, &rc, getcolor(col));
+        FillRect(&rc, getcolor(col));
     }
 }
 
-//lots of code from https://github.com/SDL-mirror/SDL/blob/bc59d0d4a2c814900a506d097a381077b9310509/src/video/SDL_surface.c#L625
 //coordinates should be scaled already
-static inline void Xblit(SDL_Surface* src, SDL_Rect* srcrect, SDL_Surface* dst, SDL_Rect* dstrect, int color, int flipx, int flipy)
+//color -1 draws the tile's colors through the draw palette, otherwise its pixels are drawn in color
+static void Blit(const Sprite_Sheet* sheet, int tile, int x, int y, int color, int flip)
 {
-    SDL_Rect fulldst;
-    int srcx, srcy, w, h;
-    SDL_assert(SDL_BYTESPERPIXEL(dst->format) == 2);
+    SDL_Rect drawn;
+    int      visible;
 
-    if (!dstrect)
+    if (color < 0)
+    {
+        visible = Sprite_Draw(sheet, tile, screen, x, y, draw_palette_set ? draw_palette : NULL, flip, &drawn);
+    }
+    else
     {
-        dstrect = (fulldst = (SDL_Rect){ 0,0,dst->w,dst->h }, &fulldst);
+        visible = Sprite_DrawSolid(sheet, tile, screen, x, y, (Uint8)color, &drawn);
     }
+    if (visible)
+    {
+        Damage(drawn.x, drawn.y, drawn.w, drawn.h);
+    }
+}
 
-    if (srcrect)
+// The map never changes, so a layer of a room is drawn once into a sheet
+// of a single tile and copied from there, run by run, afterwards.  Least
+// recently drawn layers are dropped to stay within MAP_CACHE_BUDGET.
+// Returns false if the layer couldn't be cached and has to be drawn tile
+// by tile.
+static int DrawMapLayer(int mx, int my, int tx, int ty, int size, int mask)
+{
+    MapLayer*    layer = NULL;
+    Sprite_Sheet sheet;
+    SDL_Surface* surf;
+    SDL_Rect     drawn;
+    int          i, x, y;
+
+    map_cache_clock++;
+    for (i = 0; i < MAP_CACHE_LAYERS; i++)
     {
-        int maxw, maxh;
+        MapLayer* l = &map_layers[i];
 
-        srcx = srcrect->x;
-        w = srcrect->w;
-        if (srcx < 0)
+        if (l->sheet.tiles && l->mx == mx && l->my == my && l->size == size && l->mask == mask)
         {
-            w += srcx;
-            dstrect->x -= srcx;
-            srcx = 0;
+            layer = l;
+            map_cache_stats.hits++;
+            break;
         }
-        maxw = src->w - srcx;
-        if (maxw < w)
+    }
+
+    if (!layer)
+    {
+        map_cache_stats.misses++;
+        surf = SDL_CreateSurface(size * 8 * SCALE, size * 8 * SCALE, SDL_PIXELFORMAT_INDEX8);
+        if (!surf)
         {
-            w = maxw;
+            return false;
+        }
+        SDL_FillSurfaceRect(surf, NULL, 0);
+        for (y = 0; y < size; y++)
+        {
+            for (x = 0; x < size; x++)
+            {
+                int tile = tilemap_data[x + mx + (y + my) * 128];
+                if (maptileshown(tile, mask))
+                {
+                    Sprite_Draw(&gfx, tile, surf, x * 8 * SCALE, y * 8 * SCALE, NULL, 0, NULL);
+                }
+            }
         }
 
-        srcy = srcrect->y;
-        h = srcrect->h;
-        if (srcy < 0)
+        if (!Sprite_CreateSheet(&sheet, surf, size * 8 * SCALE, 0))
         {
-            h += srcy;
-            dstrect->y -= srcy;
-            srcy = 0;
+            SDL_DestroySurface(surf);
+            return false;
         }
-        maxh = src->h - srcy;
-        if (maxh < h)
+        SDL_DestroySurface(surf);
+        if (sheet.bytes > MAP_CACHE_BUDGET)
         {
-            h = maxh;
+            Sprite_DestroySheet(&sheet);
+            return false;
         }
 
-    }
-    else
-    {
-        srcx = srcy = 0;
-        w = src->w;
-        h = src->h;
-    }
+        for (;;)
+        {
+            MapLayer* oldest = NULL;
 
-    SDL_Rect clip;
-    SDL_GetSurfaceClipRect(dst, &clip);
-    int dx, dy;
+            layer = NULL;
+            for (i = 0; i < MAP_CACHE_LAYERS; i++)
+            {
+                MapLayer* l = &map_layers[i];
 
-    dx = clip.x - dstrect->x;
-    if (dx > 0)
-    {
-        w -= dx;
-        dstrect->x += dx;
-        srcx += dx;
-    }
-    dx = dstrect->x + w - clip.x - clip.w;
-    if (dx > 0)
-    {
-        w -= dx;
-    }
+                if (!l->sheet.tiles)
+                {
+                    layer = l;
+                }
+                else if (!oldest || l->used < oldest->used)
+                {
+                    oldest = l;
+                }
+            }
+            if (layer && map_cache_stats.bytes + sheet.bytes <= MAP_CACHE_BUDGET)
+            {
+                break;
+            }
+            map_cache_stats.bytes -= oldest->sheet.bytes;
+            map_cache_stats.layers--;
+            Sprite_DestroySheet(&oldest->sheet);
+        }
 
-    dy = clip.y - dstrect->y;
-    if (dy > 0)
-    {
-        h -= dy;
-        dstrect->y += dy;
-        srcy += dy;
+        layer->sheet = sheet;
+        layer->mx = mx;
+        layer->my = my;
+        layer->size = size;
+        layer->mask = mask;
+        map_cache_stats.bytes += layer->sheet.bytes;
+        map_cache_stats.layers++;
     }
-    dy = dstrect->y + h - clip.y - clip.h;
-    if (dy > 0)
+
+    layer->used = map_cache_clock;
+    if (Sprite_Draw(&layer->sheet, 0, screen, (tx - camera_x) * SCALE, (ty - camera_y) * SCALE,
+                    draw_palette_set ? draw_palette : NULL, 0, &drawn))
     {
-        h -= dy;
+        Damage(drawn.x, drawn.y, drawn.w, drawn.h);
     }
+    return true;
+}
 
-    if (w && h)
+static void FreeMapLayers(void)
+{
+    for (int i = 0; i < MAP_CACHE_LAYERS; i++)
     {
-        Uint16* srcpix = (Uint16*)src->pixels;
-        Uint16* dstpix = (Uint16*)dst->pixels;
-        int srcpitch = src->pitch / 2;
-        int dstpitch = dst->pitch / 2;
-        int x, y;
-
-        for (y = 0; y < h; y++)
-        {
-            for (x = 0; x < w; x++)
-            {
-                Uint16 p = srcpix[!flipx ? srcx + x + (srcy + y) * srcpitch : srcx + (w - x - 1) + (srcy + y) * srcpitch];
-                if (p)
-                {
-                    dstpix[dstrect->x + x + (dstrect->y + y) * dstpitch] = p;
-                }
-            }
-        }
+        Sprite_DestroySheet(&map_layers[i].sheet);
     }
+    map_cache_stats.layers = 0;
+    map_cache_stats.bytes = 0;
 }
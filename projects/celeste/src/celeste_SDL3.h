@@ -23,9 +23,125 @@
 
 #define SCALE 1
 
+// Rewind history, about ten seconds at 30 fps.
+#define REWIND_BUDGET            (256 * 1024)
+#define REWIND_KEYFRAME_INTERVAL 60
+
+// celeste.sav starts with SAVE_MAGIC and the size of the state, and a
+// state saved by a build with another layout is refused.  The
+// fixed-point state is the same size as the float one, so it gets its
+// own magic.
+#ifdef CELESTE_P8_FIXEDPOINT
+#define SAVE_MAGIC 0x58564153 // "SAVX" on a little-endian machine.
+#else
+#define SAVE_MAGIC 0x45564153 // "SAVE" on a little-endian machine.
+#endif
+
+// Dirty rectangles kept per frame before they collapse into one, and the
+// pixels an upload may waste to save a separate one.
+#define DIRTY_MAX   32
+#define DIRTY_SLACK (64 * SCALE * SCALE)
+
+// Prerendered map layers, three per room, and the memory they may take.
+#define MAP_CACHE_LAYERS 12
+#define MAP_CACHE_BUDGET (64 * 1024 * SCALE * SCALE)
+
+// Sounds are loaded when first played, and the least recently played are
+// dropped past the budget, about eight seconds at 8 kHz.  Pinned sounds
+// are loaded up front and kept: jump, wall jump and dash.
+#define SOUND_CACHE_BUDGET (128 * 1024)
+#define SOUND_CACHE_PINNED { 1, 2, 3 }
+
+// The game runs at PACER_HZ whatever the display refresh.  Frames that
+// fall behind are run without drawing them, at most PACER_MAX_SKIP in a
+// row, before the game slows down instead.
+#define PACER_HZ       30
+#define PACER_MAX_SKIP 2
+
+// Frames run per display refresh while fast forwarding, the last drawn.
+#define TURBO_FRAMES 4
+
+// Events the trace written on exit holds, the last half minute or so.
+#define TRACE_EVENTS 8192
+
+// Frames the timing shown with '#' is taken over, a second at 30 fps.
+#define TIMING_WINDOW 30
+
+// Parts of Iterate() that are timed.
+enum
+{
+    TIMING_INPUT,  // Keyboard, reset and replay.
+    TIMING_UPDATE, // Celeste_P8_update().
+    TIMING_REWIND, // Rewind_Push() or Rewind_Step().
+    TIMING_DRAW,   // Celeste_P8_draw() or the pause box.
+    TIMING_OSD,
+    TIMING_FLIP,   // Resolve, upload and present.
+    TIMING_PHASES
+};
+
+typedef struct
+{
+    Uint32 last;   // Bytes uploaded to the screen texture by the last frame.
+    Uint64 total;  // Bytes uploaded since Init().
+    Uint64 frames;
+
+} UploadStats;
+
+typedef struct
+{
+    int    layers; // Map layers currently cached.
+    size_t bytes;  // Memory they take, at most MAP_CACHE_BUDGET.
+    Uint64 hits;
+    Uint64 misses;
+
+} MapCacheStats;
+
+typedef struct
+{
+    int    sounds;  // Sounds currently loaded.
+    size_t bytes;   // Samples they hold, over SOUND_CACHE_BUDGET only while all the rest play or are pinned.
+    size_t bundled; // Samples of every sound held by the bundle, 0 without one.  They stay loaded with it,
+                    // so sounds played from there add nothing to bytes and are never dropped.
+    Uint64 hits;
+    Uint64 misses;
+
+} SoundCacheStats;
+
+typedef struct
+{
+    Uint64 frames;  // Game frames run, one per 1/PACER_HZ s.
+    Uint64 drawn;   // Of those, drawn and presented.
+    Uint64 skipped; // Run without drawing, to catch up: dropped frames.
+    Uint64 late;    // Drawn still behind after PACER_MAX_SKIP skips.
+    Uint64 lost;    // Frames of time given up after those, the game slowed down by.
+    Uint64 turbo;   // Run without drawing while fast forwarding.
+
+} PacerStats;
+
+typedef struct
+{
+    Uint64 min, max; // In SDL_GetPerformanceCounter() ticks.
+    Uint64 total;
+    Uint64 frames;   // The phase ran in, it is skipped while paused or rewinding.
+
+} TimingPhase;
+
+typedef struct
+{
+    TimingPhase last[TIMING_PHASES];    // The last full TIMING_WINDOW frames.
+    TimingPhase session[TIMING_PHASES]; // Since Init().
+
+} TimingStats;
+
 int Init();
 SDL_AppResult HandleEvents(SDL_Event* ev);
-int Iterate();
+SDL_AppResult Iterate();
+int StartGolden(const char* replay, const char* golden, int record);
 void Destroy();
+void GetUploadStats(UploadStats* stats);
+void GetMapCacheStats(MapCacheStats* stats);
+void GetSoundCacheStats(SoundCacheStats* stats);
+void GetPacerStats(PacerStats* stats);
+void GetTimingStats(TimingStats* stats);
 
 #endif // CELESTE_SDL3_H
@@ -0,0 +1,718 @@
+/* @file celeste_bench.c
+ *
+ * A headless benchmark driver for the Celeste engine core.
+ *
+ * Links only celeste.c against a stub callback, drives
+ * Celeste_P8_update() and Celeste_P8_draw() for a fixed number of
+ * frames using a scripted input stream and reports the time spent in
+ * each phase, free of any renderer or vsync noise.
+ *
+ * Usage: celeste_bench [-n frames] [-s seed] [-i script]
+ *                      [-r trace | -c trace] [-w rewind KiB]
+ *                      [-o replay | -p replay] [-V] [-l]
+ *
+ * The input script is a plain text file with one "<frames> <buttons>"
+ * pair per line, e.g. "12 RZ" holds right and jump for 12 frames.
+ * Buttons are L, R, U, D, Z (jump) and X (dash), '-' means no input.
+ * Lines starting with '#' are ignored.  When the script runs out of
+ * lines it starts over at the line following "loop", or at the top.
+ *
+ * With -r, a golden trace is recorded: one "<frame> <room x> <room y>
+ * <draw hash>" line per frame, where the draw hash covers every
+ * drawing call issued during that frame.  With -c, the run is checked
+ * against such a trace, e.g. one recorded by a float build, and the
+ * first frame where the room progression diverges is reported.  This
+ * is what proves that CELESTE_P8_FIXEDPOINT plays out the same game;
+ * bench/rooms.txt and its float trace bench/rooms.golden cover the
+ * first three rooms, which the default script never leaves.
+ *
+ * With -w, every frame is pushed to a rewind history of the given
+ * budget, which is then stepped all the way back, checking each
+ * restored state against the one saved on the way forward.
+ *
+ * With -o, the run is recorded as a replay (see replay.c).  With -p, a
+ * replay replaces -n, -s and -i: its seed and buttons are played back
+ * at full speed, and the final state is checked against the recording,
+ * which makes the same workload comparable between builds.
+ *
+ * The stub primitives are installed with Celeste_P8_set_backend(), or
+ * with -V behind the variadic Celeste_P8_set_call_func() interface, so
+ * the two ways of dispatching can be compared on the same run.  With -l,
+ * Celeste_P8_draw() fills a draw list which is then run through them,
+ * and the draw time covers both.
+ *
+ */
+
+#include <stdio.h>
+#include <SDL3/SDL.h>
+#include "celeste.h"
+#include "replay.h"
+#include "rewind.h"
+#include "tilemap.h"
+
+#define BENCH_DEFAULT_FRAMES  10000
+#define BENCH_DEFAULT_SEED    0x2a
+#define BENCH_MAX_STEPS       1024
+#define BENCH_REWIND_INTERVAL 60
+
+typedef struct
+{
+    int    frames;
+    Uint16 buttons;
+
+} bench_step_t;
+
+// Leaves the title screen, then loops a mix of running, jumping,
+// dashing and wall climbing that keeps the player dying and respawning.
+static const char default_script[] =
+    "60 -\n"
+    "1 Z\n"
+    "90 -\n"
+    "loop\n"
+    "20 R\n"
+    "6 RZ\n"
+    "10 R\n"
+    "1 RUX\n"
+    "12 R\n"
+    "8 L\n"
+    "4 LZ\n"
+    "1 UX\n"
+    "14 -\n"
+    "16 R\n"
+    "3 RZ\n"
+    "1 RX\n"
+    "20 U\n"
+    "6 LZ\n"
+    "1 LUX\n"
+    "18 L\n"
+    "30 -\n";
+
+static bench_step_t steps[BENCH_MAX_STEPS];
+static int          step_count = 0;
+static int          loop_start = 0;
+static int          step_index = 0;
+static int          step_frame = 0;
+static Uint16       buttons_state = 0;
+
+static Uint32 draw_calls = 0;
+static Uint32 map_calls = 0;
+static Uint32 draw_hash = 0x811c9dc5;
+static int    room_x = 0, room_y = 0;
+
+// 32-bit FNV-1a.
+static Uint32 hash_bytes(Uint32 hash, const void* data, size_t size)
+{
+    const Uint8* p = (const Uint8*)data;
+
+    while (size--)
+    {
+        hash ^= *p++;
+        hash *= 0x01000193;
+    }
+    return hash;
+}
+
+static void hash_call(CELESTE_P8_CALLBACK_TYPE call, int count, const int* args)
+{
+    int argv[8];
+    int i;
+
+    argv[0] = call;
+    for (i = 1; i <= count; i++)
+    {
+        argv[i] = args[i - 1];
+    }
+    draw_hash = hash_bytes(draw_hash, argv, (count + 1) * sizeof(*argv));
+    draw_calls++;
+}
+
+static Celeste_P8_bool_t bench_btn(int b) //btn(b)
+{
+    return (buttons_state & (1 << b)) != 0;
+}
+
+static int bench_mget(int tx, int ty) //mget(tx,ty)
+{
+    map_calls++;
+    return tilemap_data[tx + ty * 128];
+}
+
+static Celeste_P8_bool_t bench_fget(int tile, int flag) //fget(tile,flag)
+{
+    map_calls++;
+    return tile < sizeof(tile_flags) / sizeof(*tile_flags) && (tile_flags[tile] & (1 << flag)) != 0;
+}
+
+static void bench_music(int track, int fade, int mask)
+{
+    (void)track, (void)fade, (void)mask;
+}
+
+static void bench_sfx(int id)
+{
+    (void)id;
+}
+
+// Drawing primitives only feed the trace.
+static void bench_spr(int sprite, int x, int y, int cols, int rows, Celeste_P8_bool_t flipx, Celeste_P8_bool_t flipy)
+{
+    int args[] = { sprite, x, y, cols, rows, flipx, flipy };
+    hash_call(CELESTE_P8_SPR, 7, args);
+}
+
+static void bench_pal(int a, int b)
+{
+    int args[] = { a, b };
+    hash_call(CELESTE_P8_PAL, 2, args);
+}
+
+static void bench_pal_reset(void)
+{
+    hash_call(CELESTE_P8_PAL_RESET, 0, NULL);
+}
+
+static void bench_circfill(int x, int y, int r, int c)
+{
+    int args[] = { x, y, r, c };
+    hash_call(CELESTE_P8_CIRCFILL, 4, args);
+}
+
+static void bench_print(const char* str, int x, int y, int c)
+{
+    int args[] = { x, y, c };
+    draw_hash = hash_bytes(draw_hash, str, SDL_strlen(str));
+    hash_call(CELESTE_P8_PRINT, 3, args);
+}
+
+static void bench_rectfill(int x, int y, int x2, int y2, int c)
+{
+    int args[] = { x, y, x2, y2, c };
+    hash_call(CELESTE_P8_RECTFILL, 5, args);
+}
+
+static void bench_line(int x, int y, int x2, int y2, int c)
+{
+    int args[] = { x, y, x2, y2, c };
+    hash_call(CELESTE_P8_LINE, 5, args);
+}
+
+static void bench_camera(int x, int y)
+{
+    int args[] = { x, y };
+    hash_call(CELESTE_P8_CAMERA, 2, args);
+}
+
+static void bench_map(int mx, int my, int tx, int ty, int mw, int mh, int mask)
+{
+    int args[] = { mx, my, tx, ty, mw, mh, mask };
+    room_x = mx / 16;
+    room_y = my / 16;
+    hash_call(CELESTE_P8_MAP, 7, args);
+}
+
+static const struct Celeste_P8_backend bench_backend =
+{
+    bench_music, bench_spr, bench_btn, bench_sfx,
+    bench_pal, bench_pal_reset, bench_circfill, bench_print,
+    bench_rectfill, bench_line, bench_mget, bench_camera,
+    bench_fget, bench_map
+};
+
+// The same primitives behind the variadic interface, to compare the cost
+// of both ways of dispatching.
+static int bench_emu(CELESTE_P8_CALLBACK_TYPE call, ...)
+{
+    va_list args;
+    int     a[7];
+    int     ret = 0;
+
+#define INT_ARGS(n) do { int i_; for (i_ = 0; i_ < (n); i_++) a[i_] = va_arg(args, int); } while (0)
+
+    va_start(args, call);
+
+    switch (call)
+    {
+        case CELESTE_P8_MUSIC:    INT_ARGS(3); bench_music(a[0], a[1], a[2]); break;
+        case CELESTE_P8_SPR:      INT_ARGS(7); bench_spr(a[0], a[1], a[2], a[3], a[4], a[5], a[6]); break;
+        case CELESTE_P8_BTN:      INT_ARGS(1); ret = bench_btn(a[0]); break;
+        case CELESTE_P8_SFX:      INT_ARGS(1); bench_sfx(a[0]); break;
+        case CELESTE_P8_PAL:      INT_ARGS(2); bench_pal(a[0], a[1]); break;
+        case CELESTE_P8_PAL_RESET: bench_pal_reset(); break;
+        case CELESTE_P8_CIRCFILL: INT_ARGS(4); bench_circfill(a[0], a[1], a[2], a[3]); break;
+        case CELESTE_P8_PRINT:
+        {
+            const char* str = va_arg(args, const char*);
+            INT_ARGS(3);
+            bench_print(str, a[0], a[1], a[2]);
+            break;
+        }
+        case CELESTE_P8_RECTFILL: INT_ARGS(5); bench_rectfill(a[0], a[1], a[2], a[3], a[4]); break;
+        case CELESTE_P8_LINE:     INT_ARGS(5); bench_line(a[0], a[1], a[2], a[3], a[4]); break;
+        case CELESTE_P8_MGET:     INT_ARGS(2); ret = bench_mget(a[0], a[1]); break;
+        case CELESTE_P8_CAMERA:   INT_ARGS(2); bench_camera(a[0], a[1]); break;
+        case CELESTE_P8_FGET:     INT_ARGS(2); ret = bench_fget(a[0], a[1]); break;
+        case CELESTE_P8_MAP:      INT_ARGS(7); bench_map(a[0], a[1], a[2], a[3], a[4], a[5], a[6]); break;
+    }
+
+#undef INT_ARGS
+
+    va_end(args);
+    return ret;
+}
+
+static int parse_script(const char* text)
+{
+    const char* p = text;
+
+    step_count = 0;
+    loop_start = 0;
+    while (*p)
+    {
+        int    frames = 0;
+        Uint16 buttons = 0;
+
+        while (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n')
+        {
+            p++;
+        }
+        if (*p == '#')
+        {
+            while (*p && *p != '\n')
+            {
+                p++;
+            }
+            continue;
+        }
+        if (!*p)
+        {
+            break;
+        }
+        if (!SDL_strncmp(p, "loop", 4))
+        {
+            loop_start = step_count;
+            p += 4;
+            continue;
+        }
+        while (*p >= '0' && *p <= '9')
+        {
+            frames = frames * 10 + (*p++ - '0');
+        }
+        while (*p == ' ' || *p == '\t')
+        {
+            p++;
+        }
+        for (; *p && *p != '\n' && *p != '\r'; p++)
+        {
+            switch (*p)
+            {
+                case 'L': buttons |= (1 << 0); break;
+                case 'R': buttons |= (1 << 1); break;
+                case 'U': buttons |= (1 << 2); break;
+                case 'D': buttons |= (1 << 3); break;
+                case 'Z': buttons |= (1 << 4); break;
+                case 'X': buttons |= (1 << 5); break;
+                case '-': case ' ': case '\t': break;
+                default:
+                    SDL_Log("script: unknown button '%c'", *p);
+                    return false;
+            }
+        }
+        if (frames <= 0)
+        {
+            continue;
+        }
+        if (step_count >= BENCH_MAX_STEPS)
+        {
+            SDL_Log("script: too many steps (max %d)", BENCH_MAX_STEPS);
+            return false;
+        }
+        steps[step_count].frames = frames;
+        steps[step_count].buttons = buttons;
+        step_count++;
+    }
+
+    if (loop_start >= step_count)
+    {
+        loop_start = 0;
+    }
+
+    return step_count > 0;
+}
+
+static char* load_text(const char* path)
+{
+    FILE* file = fopen(path, "rb");
+    char* text;
+    long  size;
+
+    if (!file)
+    {
+        return NULL;
+    }
+    fseek(file, 0, SEEK_END);
+    size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+
+    text = (char*)SDL_malloc(size + 1);
+    if (text)
+    {
+        size = (long)fread(text, 1, size, file);
+        text[size] = '\0';
+    }
+    fclose(file);
+    return text;
+}
+
+static void next_input(void)
+{
+    buttons_state = steps[step_index].buttons;
+    if (++step_frame >= steps[step_index].frames)
+    {
+        step_frame = 0;
+        if (++step_index >= step_count)
+        {
+            step_index = loop_start;
+        }
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    int      frames = BENCH_DEFAULT_FRAMES;
+    unsigned seed = BENCH_DEFAULT_SEED;
+    char*    script = NULL;
+    size_t   rewind_budget = 0;
+    Uint32*  rewind_hashes = NULL;
+    Uint64   rewind_ticks = 0;
+    FILE*    trace_out = NULL;
+    FILE*    trace_in = NULL;
+    const char*   replay_out = NULL;
+    Replay_Header replay;
+    int           replaying = 0;
+    int           variadic = 0;
+    Celeste_P8_draw_list_t* draw_list = NULL;
+    Uint64                  draw_list_cmds = 0;
+    int                     draw_list_max = 0;
+    int      diverged = -1, draw_diverged = -1;
+    Uint64   update_ticks = 0, draw_ticks = 0;
+    Uint64   freq = SDL_GetPerformanceFrequency();
+    void*    state;
+    Celeste_P8_stats_t stats;
+    double   total_s;
+    int      i;
+
+    for (i = 1; i < argc; i++)
+    {
+        if (!SDL_strcmp(argv[i], "-n") && i + 1 < argc)
+        {
+            frames = SDL_atoi(argv[++i]);
+            if (frames <= 0)
+            {
+                SDL_Log("Frame count must be positive");
+                return 1;
+            }
+        }
+        else if (!SDL_strcmp(argv[i], "-s") && i + 1 < argc)
+        {
+            seed = (unsigned)SDL_strtoul(argv[++i], NULL, 0);
+        }
+        else if (!SDL_strcmp(argv[i], "-i") && i + 1 < argc)
+        {
+            script = load_text(argv[++i]);
+            if (!script)
+            {
+                SDL_Log("Couldn't read script '%s'", argv[i]);
+                return 1;
+            }
+        }
+        else if ((!SDL_strcmp(argv[i], "-r") || !SDL_strcmp(argv[i], "-c")) && i + 1 < argc)
+        {
+            FILE** trace = argv[i][1] == 'r' ? &trace_out : &trace_in;
+            *trace = fopen(argv[i + 1], argv[i][1] == 'r' ? "w" : "r");
+            if (!*trace)
+            {
+                SDL_Log("Couldn't open trace '%s'", argv[i + 1]);
+                return 1;
+            }
+            i++;
+        }
+        else if (!SDL_strcmp(argv[i], "-w") && i + 1 < argc)
+        {
+            rewind_budget = (size_t)SDL_atoi(argv[++i]) * 1024;
+        }
+        else if (!SDL_strcmp(argv[i], "-V"))
+        {
+            variadic = 1;
+        }
+        else if (!SDL_strcmp(argv[i], "-l"))
+        {
+            draw_list = SDL_malloc(sizeof(*draw_list));
+            if (!draw_list)
+            {
+                SDL_Log("Out of memory");
+                return 1;
+            }
+        }
+        else if (!SDL_strcmp(argv[i], "-o") && i + 1 < argc)
+        {
+            replay_out = argv[++i];
+        }
+        else if (!SDL_strcmp(argv[i], "-p") && i + 1 < argc)
+        {
+            if (!Replay_Load(argv[++i], &replay))
+            {
+                return 1;
+            }
+            replaying = 1;
+        }
+        else
+        {
+            SDL_Log("Usage: %s [-n frames] [-s seed] [-i script] [-r trace | -c trace] [-w rewind KiB] [-o replay | -p replay] [-V] [-l]", argv[0]);
+            return 1;
+        }
+    }
+
+    if (replaying)
+    {
+        if (replay_out)
+        {
+            SDL_Log("Can't record a replay while playing one back");
+            return 1;
+        }
+        if (!replay.frames)
+        {
+            SDL_Log("Replay has no frames");
+            return 1;
+        }
+        seed = replay.seed;
+        frames = (int)replay.frames;
+    }
+
+    if (!parse_script(script ? script : default_script))
+    {
+        SDL_Log("Empty or invalid input script");
+        return 1;
+    }
+
+    if (variadic)
+    {
+        Celeste_P8_set_call_func(bench_emu);
+    }
+    else
+    {
+        Celeste_P8_set_backend(&bench_backend);
+    }
+    Celeste_P8_set_draw_list(draw_list);
+    Celeste_P8_set_rndseed(seed);
+    Celeste_P8_init();
+
+    if (replaying && Replay_HashState() != replay.initial_hash)
+    {
+        SDL_Log("replay:        initial state differs, recorded by a different build?");
+    }
+    if (replay_out && !Replay_StartRecording(seed))
+    {
+        return 1;
+    }
+
+    state = SDL_malloc(Celeste_P8_get_state_size());
+    if (!state)
+    {
+        SDL_Log("Out of memory");
+        return 1;
+    }
+    if (rewind_budget)
+    {
+        rewind_hashes = SDL_malloc(frames * sizeof(*rewind_hashes));
+        if (!rewind_hashes || !Rewind_Init(rewind_budget, BENCH_REWIND_INTERVAL))
+        {
+            return 1;
+        }
+    }
+
+    for (i = 0; i < frames; i++)
+    {
+        Uint64 t0, t1, t2;
+
+        if (replaying)
+        {
+            Replay_NextFrame(&buttons_state);
+        }
+        else
+        {
+            next_input();
+        }
+        if (replay_out)
+        {
+            Replay_RecordFrame(buttons_state);
+        }
+
+        t0 = SDL_GetPerformanceCounter();
+        Celeste_P8_update();
+        t1 = SDL_GetPerformanceCounter();
+        Celeste_P8_draw();
+        if (draw_list)
+        {
+            Celeste_P8_run_draw_list(draw_list, NULL);
+        }
+        t2 = SDL_GetPerformanceCounter();
+
+        update_ticks += t1 - t0;
+        draw_ticks += t2 - t1;
+
+        if (draw_list)
+        {
+            draw_list_cmds += draw_list->count;
+            draw_list_max = SDL_max(draw_list_max, draw_list->count);
+        }
+
+        if (rewind_hashes)
+        {
+            t0 = SDL_GetPerformanceCounter();
+            Rewind_Push();
+            rewind_ticks += SDL_GetPerformanceCounter() - t0;
+
+            Celeste_P8_save_state(state);
+            rewind_hashes[i] = hash_bytes(0x811c9dc5, state, Celeste_P8_get_state_size());
+        }
+
+        if (trace_out)
+        {
+            fprintf(trace_out, "%d %d %d %08x\n", i, room_x, room_y, (unsigned)draw_hash);
+        }
+        else if (trace_in && diverged < 0)
+        {
+            int      frame, x, y;
+            unsigned hash;
+
+            if (fscanf(trace_in, "%d %d %d %x", &frame, &x, &y, &hash) != 4 || frame != i)
+            {
+                SDL_Log("trace: ends before frame %d", i);
+                diverged = i;
+            }
+            else if (x != room_x || y != room_y)
+            {
+                SDL_Log("trace: room progression diverges at frame %d: %d,%d instead of %d,%d", i, room_x, room_y, x, y);
+                diverged = i;
+            }
+            else if (hash != draw_hash && draw_diverged < 0)
+            {
+                draw_diverged = i;
+            }
+        }
+        draw_hash = 0x811c9dc5;
+    }
+
+    Celeste_P8_save_state(state);
+    Celeste_P8_get_stats(&stats);
+
+    total_s = (double)(update_ticks + draw_ticks) / freq;
+
+    SDL_Log("frames:        %d", frames);
+    SDL_Log("seed:          0x%x", seed);
+    SDL_Log("dispatch:      %s", variadic ? "variadic" : "backend table");
+    SDL_Log("frames/sec:    %.1f", frames / (total_s > 0 ? total_s : 1));
+    SDL_Log("update:        %.1f ns/frame", update_ticks * 1e9 / freq / frames);
+    SDL_Log("draw:          %.1f ns/frame", draw_ticks * 1e9 / freq / frames);
+    SDL_Log("draw calls:    %.1f /frame", (double)draw_calls / frames);
+    if (draw_list)
+    {
+        SDL_Log("draw list:     %.1f commands/frame, at most %d of %d, %u bytes/command",
+                (double)draw_list_cmds / frames, draw_list_max, CELESTE_P8_DRAW_LIST_SIZE, (unsigned)sizeof(Celeste_P8_draw_cmd_t));
+        if (draw_list_max > CELESTE_P8_DRAW_LIST_SIZE)
+        {
+            SDL_Log("draw list:     commands were dropped");
+        }
+    }
+    SDL_Log("tile queries:  %.1f /frame", (double)stats.tile_queries / frames);
+    SDL_Log("mget/fget:     %.1f /frame", (double)map_calls / frames);
+    SDL_Log("obj queries:   %.1f /frame, %.1f objects tested", (double)stats.obj_queries / frames, (double)stats.obj_candidates / frames);
+
+    SDL_Log("state size:    %u bytes", (unsigned)Celeste_P8_get_state_size());
+    SDL_Log("state hash:    %08x", hash_bytes(0x811c9dc5, state, Celeste_P8_get_state_size()));
+
+    if (rewind_hashes)
+    {
+        Rewind_Stats rs;
+        Uint64       t0, step_ticks = 0;
+        int          steps = 0, bad = -1;
+
+        Rewind_GetStats(&rs);
+        SDL_Log("rewind:        %d frames in %u of %u bytes, %.1f bytes/frame, %.1f%% keyframes",
+                rs.frames, (unsigned)rs.used, (unsigned)rewind_budget,
+                (double)rs.pushed_bytes / rs.pushed, 100.0 * rs.keyframes / rs.pushed);
+        SDL_Log("rewind push:   %.2f us/frame", rewind_ticks * 1e6 / freq / frames);
+
+        for (;;)
+        {
+            t0 = SDL_GetPerformanceCounter();
+            if (!Rewind_Step())
+            {
+                break;
+            }
+            step_ticks += SDL_GetPerformanceCounter() - t0;
+            steps++;
+
+            Celeste_P8_save_state(state);
+            if (bad < 0 && hash_bytes(0x811c9dc5, state, Celeste_P8_get_state_size()) != rewind_hashes[frames - 1 - steps])
+            {
+                bad = frames - 1 - steps;
+            }
+        }
+        SDL_Log("rewind step:   %.2f us/frame over %d frames", steps ? step_ticks * 1e6 / freq / steps : 0, steps);
+        if (bad >= 0)
+        {
+            SDL_Log("rewind:        state of frame %d restored wrong", bad);
+            diverged = bad;
+        }
+
+        Rewind_Destroy();
+        SDL_free(rewind_hashes);
+    }
+
+    if (replay_out)
+    {
+        if (!Replay_Save(replay_out))
+        {
+            return 1;
+        }
+        SDL_Log("replay:        %d frames recorded to %s", frames, replay_out);
+    }
+    if (replaying)
+    {
+        if (Replay_HashState() == replay.final_hash)
+        {
+            SDL_Log("replay:        final state matches the recording");
+        }
+        else
+        {
+            SDL_Log("replay:        final state differs from the recording");
+            diverged = frames;
+        }
+    }
+    Replay_Stop();
+
+    if (trace_out)
+    {
+        fclose(trace_out);
+    }
+
+    if (trace_in)
+    {
+        fclose(trace_in);
+        if (diverged < 0)
+        {
+            SDL_Log("trace:         room progression identical");
+        }
+        if (draw_diverged >= 0)
+        {
+            SDL_Log("trace:         draw calls first differ at frame %d", draw_diverged);
+        }
+    }
+
+    SDL_free(draw_list);
+    SDL_free(state);
+    SDL_free(script);
+
+    return diverged < 0 ? 0 : 2;
+}
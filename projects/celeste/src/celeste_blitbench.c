@@ -0,0 +1,408 @@
+/* @file celeste_blitbench.c
+ *
+ * A micro-benchmark for drawing sprites.
+ *
+ * Draws every tile of gfx.bmp with the per-pixel blit the SDL3 frontend
+ * used before sprite sheets were span encoded, and with Sprite_Draw()
+ * from sprite.c, which copies runs of opaque pixels.  Both are checked
+ * to leave the same pixels behind, then timed over repeated passes
+ * over all the tiles.  Throughput counts every pixel of a tile, opaque
+ * or not, so both paths are measured against the same work.
+ *
+ * Text is measured the same way: the OSD messages and the game's own
+ * strings are printed in each of the 16 colors from font.bmp, per pixel
+ * and with Sprite_DrawSolid(), which fills the runs of a sheet holding
+ * only the glyph shapes.
+ *
+ * Usage: celeste_blitbench [-n passes] [-s scale] [-d data directory]
+ *
+ */
+
+#include <SDL3/SDL.h>
+#include "palette.h"
+#include "sprite.h"
+
+#define BLITBENCH_DEFAULT_PASSES 2000
+
+typedef struct
+{
+    const char* name;
+    int         lut;   // 0 for the colors as they are, 1 with a pal() swap.
+    int         flipx;
+
+} blit_mode_t;
+
+static const blit_mode_t modes[] =
+{
+    { "spr",        0, 0 },
+    { "spr flip x", 0, 1 },
+    { "spr pal()",  1, 0 },
+};
+
+static const char* const strings[] =
+{
+    "save state", "load state", "screenshake: off", "rewind", "replay done",
+    "00:12:34", "1000 m", "old site", "x+c", "matt thorson", "noel berry", "deaths:42",
+};
+
+// The frontend's Xblit() before sprite.c, drawing color indices through lut.
+static void Xblit(SDL_Surface* src, SDL_Rect* srcrect, SDL_Surface* dst, SDL_Rect* dstrect, const Uint8* lut, int flipx)
+{
+    SDL_Rect fulldst;
+    int srcx, srcy, w, h;
+    SDL_assert(SDL_BYTESPERPIXEL(src->format) == 1 && SDL_BYTESPERPIXEL(dst->format) == 1);
+
+    if (!dstrect)
+    {
+        dstrect = (fulldst = (SDL_Rect){ 0,0,dst->w,dst->h }, &fulldst);
+    }
+
+    if (srcrect)
+    {
+        int maxw, maxh;
+
+        srcx = srcrect->x;
+        w = srcrect->w;
+        if (srcx < 0)
+        {
+            w += srcx;
+            dstrect->x -= srcx;
+            srcx = 0;
+        }
+        maxw = src->w - srcx;
+        if (maxw < w)
+        {
+            w = maxw;
+        }
+
+        srcy = srcrect->y;
+        h = srcrect->h;
+        if (srcy < 0)
+        {
+            h += srcy;
+            dstrect->y -= srcy;
+            srcy = 0;
+        }
+        maxh = src->h - srcy;
+        if (maxh < h)
+        {
+            h = maxh;
+        }
+
+    }
+    else
+    {
+        srcx = srcy = 0;
+        w = src->w;
+        h = src->h;
+    }
+
+    SDL_Rect clip;
+    SDL_GetSurfaceClipRect(dst, &clip);
+    int dx, dy;
+
+    dx = clip.x - dstrect->x;
+    if (dx > 0)
+    {
+        w -= dx;
+        dstrect->x += dx;
+        srcx += dx;
+    }
+    dx = dstrect->x + w - clip.x - clip.w;
+    if (dx > 0)
+    {
+        w -= dx;
+    }
+
+    dy = clip.y - dstrect->y;
+    if (dy > 0)
+    {
+        h -= dy;
+        dstrect->y += dy;
+        srcy += dy;
+    }
+    dy = dstrect->y + h - clip.y - clip.h;
+    if (dy > 0)
+    {
+        h -= dy;
+    }
+
+    if (w > 0 && h > 0)
+    {
+        Uint8* srcpix = (Uint8*)src->pixels;
+        Uint8* dstpix = (Uint8*)dst->pixels;
+        int srcpitch = src->pitch;
+        int dstpitch = dst->pitch;
+        int x, y;
+
+        for (y = 0; y < h; y++)
+        {
+            for (x = 0; x < w; x++)
+            {
+                Uint8 p = srcpix[!flipx ? srcx + x + (srcy + y) * srcpitch : srcx + (w - x - 1) + (srcy + y) * srcpitch];
+                if (p) // Color 0 is transparent.
+                {
+                    dstpix[dstrect->x + x + (dstrect->y + y) * dstpitch] = lut[p & 15];
+                }
+            }
+        }
+    }
+}
+
+static int tiles_x, tile_size;
+
+static void draw_pixels(SDL_Surface* gfx, SDL_Surface* dst, const Uint8* lut, int flipx)
+{
+    int t;
+
+    for (t = 0; t < tiles_x * (gfx->h / tile_size); t++)
+    {
+        SDL_Rect srcrc = { (t % tiles_x) * tile_size, (t / tiles_x) * tile_size, tile_size, tile_size };
+        SDL_Rect dstrc = { srcrc.x, srcrc.y, tile_size, tile_size };
+
+        Xblit(gfx, &srcrc, dst, &dstrc, lut, flipx);
+    }
+}
+
+static void draw_spans(const Sprite_Sheet* sheet, SDL_Surface* dst, const blit_mode_t* mode, const Uint8* lut)
+{
+    int t;
+
+    for (t = 0; t < sheet->tiles; t++)
+    {
+        int x = (t % tiles_x) * tile_size;
+        int y = (t / tiles_x) * tile_size;
+
+        Sprite_Draw(sheet, t, dst, x, y, mode->lut ? lut : NULL, mode->flipx ? SPRITE_FLIP_X : 0, NULL);
+    }
+}
+
+// The frontend's p8_print() before sprite.c, one line of each string per color.
+static int print_pixels(SDL_Surface* font, SDL_Surface* dst)
+{
+    int chars = 0;
+
+    for (int col = 0; col < 16; col++)
+    {
+        Uint8 lut[16];
+
+        SDL_memset(lut, col, sizeof(lut));
+        for (int i = 0; i < (int)SDL_arraysize(strings); i++)
+        {
+            const char* str = strings[i];
+            int         x = (col & 1) * 64, y = i * 8 + (col & 2) * 2;
+
+            for (char c = *str; c; c = *(++str))
+            {
+                SDL_Rect srcrc = { 8 * (c % 16) * tile_size / 8, 8 * (c / 16) * tile_size / 8, tile_size, tile_size };
+                SDL_Rect dstrc = { x * tile_size / 8, y * tile_size / 8, tile_size, tile_size };
+
+                Xblit(font, &srcrc, dst, &dstrc, lut, 0);
+                x += 4;
+                chars++;
+            }
+        }
+    }
+    return chars;
+}
+
+static void print_spans(const Sprite_Sheet* font, SDL_Surface* dst)
+{
+    for (int col = 0; col < 16; col++)
+    {
+        for (int i = 0; i < (int)SDL_arraysize(strings); i++)
+        {
+            const char* str = strings[i];
+            int         x = (col & 1) * 64, y = i * 8 + (col & 2) * 2;
+
+            for (char c = *str; c; c = *(++str))
+            {
+                Sprite_DrawSolid(font, c & 0x7F, dst, x * tile_size / 8, y * tile_size / 8, (Uint8)col, NULL);
+                x += 4;
+            }
+        }
+    }
+}
+
+static int same_pixels(SDL_Surface* a, SDL_Surface* b, const char* name)
+{
+    for (int y = 0; y < a->h; y++)
+    {
+        if (SDL_memcmp((Uint8*)a->pixels + y * a->pitch, (Uint8*)b->pixels + y * b->pitch, a->w))
+        {
+            SDL_Log("%s: spans differ from per-pixel at row %d", name, y);
+            return false;
+        }
+    }
+    return true;
+}
+
+static SDL_Surface* load(const char* dir, const char* name, int scale)
+{
+    char path[256];
+
+    if (dir)
+    {
+        SDL_snprintf(path, sizeof(path), "%s/%s", dir, name);
+    }
+    else
+    {
+        SDL_snprintf(path, sizeof(path), "%sdata/%s", SDL_GetBasePath(), name);
+    }
+    return Sprite_LoadIndexed(path, scale, p8_palette);
+}
+
+int main(int argc, char* argv[])
+{
+    Uint64       freq = SDL_GetPerformanceFrequency();
+    const char*  dir = NULL;
+    int          passes = BLITBENCH_DEFAULT_PASSES;
+    int          scale = 1;
+    int          mismatch = 0;
+    int          opaque = 0;
+    SDL_Surface* gfx;
+    SDL_Surface* font;
+    SDL_Surface* a;
+    SDL_Surface* b;
+    Sprite_Sheet sheet, glyphs, colored;
+    size_t       i;
+    int          n;
+
+    for (n = 1; n < argc; n++)
+    {
+        if (!SDL_strcmp(argv[n], "-n") && n + 1 < argc)
+        {
+            passes = SDL_atoi(argv[++n]);
+        }
+        else if (!SDL_strcmp(argv[n], "-s") && n + 1 < argc)
+        {
+            scale = SDL_atoi(argv[++n]);
+        }
+        else if (!SDL_strcmp(argv[n], "-d") && n + 1 < argc)
+        {
+            dir = argv[++n];
+        }
+        else
+        {
+            SDL_Log("Usage: %s [-n passes] [-s scale] [-d data directory]", argv[0]);
+            return 1;
+        }
+    }
+    if (passes <= 0 || scale <= 0)
+    {
+        SDL_Log("Passes and scale must be positive");
+        return 1;
+    }
+
+    gfx = load(dir, "gfx.bmp", scale);
+    font = load(dir, "font.bmp", scale);
+    if (!gfx || !font)
+    {
+        return 1;
+    }
+    tile_size = 8 * scale;
+    tiles_x = gfx->w / tile_size;
+    if (!Sprite_CreateSheet(&sheet, gfx, tile_size, SPRITE_FLIP_X) ||
+        !Sprite_CreateSheet(&glyphs, font, tile_size, SPRITE_SHAPE) ||
+        !Sprite_CreateSheet(&colored, font, tile_size, 0))
+    {
+        return 1;
+    }
+    a = SDL_CreateSurface(gfx->w, gfx->h, SDL_PIXELFORMAT_INDEX8);
+    b = SDL_CreateSurface(gfx->w, gfx->h, SDL_PIXELFORMAT_INDEX8);
+    if (!a || !b)
+    {
+        SDL_Log("SDL_CreateSurface: %s", SDL_GetError());
+        return 1;
+    }
+    for (n = 0; n < gfx->w * gfx->h; n++)
+    {
+        opaque += ((Uint8*)gfx->pixels)[n % gfx->w + n / gfx->w * gfx->pitch] != 0;
+    }
+    SDL_Log("%d tiles of %dx%d, %u spans, %.1f%% opaque, %u bytes", sheet.tiles, tile_size, tile_size,
+            (unsigned)sheet.rows[sheet.tiles * 2 * tile_size] / 2, 100.0 * opaque / (gfx->w * gfx->h),
+            (unsigned)sheet.bytes);
+
+    for (i = 0; i < SDL_arraysize(modes); i++)
+    {
+        const blit_mode_t* mode = &modes[i];
+        double pixels = (double)passes * sheet.tiles * tile_size * tile_size;
+        Uint8  lut[16];
+        Uint64 t0, t1, t2;
+        int    p, k;
+
+        for (k = 0; k < 16; k++)
+        {
+            lut[k] = (Uint8)k;
+        }
+        if (mode->lut == 1)
+        {
+            lut[8] = 2; // Madeline's hair after a dash.
+            lut[12] = 1;
+        }
+
+        SDL_FillSurfaceRect(a, NULL, 0);
+        SDL_FillSurfaceRect(b, NULL, 0);
+        draw_pixels(gfx, a, lut, mode->flipx);
+        draw_spans(&sheet, b, mode, lut);
+        mismatch |= !same_pixels(a, b, mode->name);
+
+        t0 = SDL_GetPerformanceCounter();
+        for (p = 0; p < passes; p++)
+        {
+            draw_pixels(gfx, a, lut, mode->flipx);
+        }
+        t1 = SDL_GetPerformanceCounter();
+        for (p = 0; p < passes; p++)
+        {
+            draw_spans(&sheet, b, mode, lut);
+        }
+        t2 = SDL_GetPerformanceCounter();
+
+        SDL_Log("%-10s per-pixel %7.1f pixels/us, spans %7.1f pixels/us, %.2fx", mode->name,
+                pixels * freq / 1e6 / (t1 - t0), pixels * freq / 1e6 / (t2 - t1),
+                (double)(t1 - t0) / (t2 - t1));
+    }
+
+    {
+        Uint64 t0, t1, t2;
+        double chars;
+        int    p;
+
+        SDL_FillSurfaceRect(a, NULL, 0);
+        SDL_FillSurfaceRect(b, NULL, 0);
+        chars = print_pixels(font, a);
+        print_spans(&glyphs, b);
+        mismatch |= !same_pixels(a, b, "print");
+
+        t0 = SDL_GetPerformanceCounter();
+        for (p = 0; p < passes; p++)
+        {
+            print_pixels(font, a);
+        }
+        t1 = SDL_GetPerformanceCounter();
+        for (p = 0; p < passes; p++)
+        {
+            print_spans(&glyphs, b);
+        }
+        t2 = SDL_GetPerformanceCounter();
+
+        chars *= passes;
+        SDL_Log("%-10s per-pixel %7.1f chars/us, spans %7.1f chars/us, %.2fx", "print",
+                chars * freq / 1e6 / (t1 - t0), chars * freq / 1e6 / (t2 - t1), (double)(t1 - t0) / (t2 - t1));
+        SDL_Log("%-10s a 16 character OSD line takes %.2f us per pixel, %.2f us with spans", "print",
+                16e6 * (t1 - t0) / freq / chars, 16e6 * (t2 - t1) / freq / chars);
+        SDL_Log("%-10s %u bytes of glyph runs, %u with their colors", "print",
+                (unsigned)glyphs.bytes, (unsigned)colored.bytes);
+    }
+
+    Sprite_DestroySheet(&glyphs);
+    Sprite_DestroySheet(&colored);
+    Sprite_DestroySheet(&sheet);
+    SDL_DestroySurface(a);
+    SDL_DestroySurface(b);
+    SDL_DestroySurface(gfx);
+    SDL_DestroySurface(font);
+
+    return mismatch ? 2 : 0;
+}
@@ -0,0 +1,252 @@
+/* @file celeste_bundle.c
+ *
+ * Packs the data files into the asset bundle the game loads at startup.
+ *
+ * gfx.bmp and font.bmp are matched to the PICO-8 palette with the same
+ * code the game uses for them, and kept as color indices.  Sounds are
+ * converted to mono signed 16-bit samples at BUNDLE_PCM_RATE, the format
+ * Init() opens the mixer in.  frame.bmp is copied as it is.  The bundle
+ * is read back once written, to check it loads.  See bundle.c for the
+ * file layout.
+ *
+ * Usage: celeste_bundle [-d data directory] [-o output]
+ *
+ */
+
+#include <SDL3/SDL.h>
+#include "bundle.h"
+#include "palette.h"
+#include "sprite.h"
+
+#define BUNDLE_MAX_ENTRIES 64
+
+typedef struct
+{
+    char   name[BUNDLE_NAME_MAX];
+    int    kind;
+    int    width, height;
+    Uint8* data;
+    size_t size;
+
+} entry_t;
+
+static entry_t entries[BUNDLE_MAX_ENTRIES];
+static int     entry_count = 0;
+
+static void PutU32(Uint8* p, Uint32 v)
+{
+    p[0] = (Uint8)v;
+    p[1] = (Uint8)(v >> 8);
+    p[2] = (Uint8)(v >> 16);
+    p[3] = (Uint8)(v >> 24);
+}
+
+static void PutU16(Uint8* p, Uint16 v)
+{
+    p[0] = (Uint8)v;
+    p[1] = (Uint8)(v >> 8);
+}
+
+static entry_t* AddEntry(const char* name, int kind)
+{
+    entry_t* entry;
+
+    if (entry_count == BUNDLE_MAX_ENTRIES || SDL_strlen(name) >= BUNDLE_NAME_MAX)
+    {
+        SDL_Log("Can't add %s to the bundle", name);
+        return NULL;
+    }
+    entry = &entries[entry_count++];
+    SDL_strlcpy(entry->name, name, sizeof(entry->name));
+    entry->kind = kind;
+    return entry;
+}
+
+static int AddFile(const char* dir, const char* name)
+{
+    char     path[256];
+    entry_t* entry = AddEntry(name, BUNDLE_FILE);
+
+    SDL_snprintf(path, sizeof(path), "%s/%s", dir, name);
+    if (!entry || !(entry->data = SDL_LoadFile(path, &entry->size)))
+    {
+        SDL_Log("Couldn't read '%s': %s", path, SDL_GetError());
+        return false;
+    }
+    return true;
+}
+
+static int AddIndexed(const char* dir, const char* name)
+{
+    char         path[256];
+    entry_t*     entry = AddEntry(name, BUNDLE_INDEXED);
+    SDL_Surface* surf;
+
+    SDL_snprintf(path, sizeof(path), "%s/%s", dir, name);
+    if (!entry || !(surf = Sprite_LoadIndexed(path, 1, p8_palette)))
+    {
+        return false;
+    }
+    entry->width = surf->w;
+    entry->height = surf->h;
+    entry->size = (size_t)surf->w * surf->h;
+    entry->data = SDL_malloc(entry->size);
+    if (!entry->data)
+    {
+        SDL_DestroySurface(surf);
+        return false;
+    }
+    for (int y = 0; y < surf->h; y++)
+    {
+        SDL_memcpy(entry->data + y * surf->w, (Uint8*)surf->pixels + y * surf->pitch, surf->w);
+    }
+    SDL_DestroySurface(surf);
+    return true;
+}
+
+static int AddSound(const char* path, const char* name)
+{
+    SDL_AudioSpec wav, pcm;
+    entry_t*      entry = AddEntry(name, BUNDLE_PCM);
+    Uint8*        samples;
+    Uint32        length;
+    int           size;
+
+    if (!entry || !SDL_LoadWAV(path, &wav, &samples, &length))
+    {
+        SDL_Log("Couldn't read '%s': %s", path, SDL_GetError());
+        return false;
+    }
+    pcm.format = SDL_AUDIO_S16LE;
+    pcm.channels = 1;
+    pcm.freq = BUNDLE_PCM_RATE;
+    if (!SDL_ConvertAudioSamples(&wav, samples, (int)length, &pcm, &entry->data, &size))
+    {
+        SDL_Log("Couldn't convert '%s': %s", path, SDL_GetError());
+        SDL_free(samples);
+        return false;
+    }
+    SDL_free(samples);
+    entry->size = (size_t)size;
+    return true;
+}
+
+// Writes data and zeros up to the next 4 byte boundary.
+static int WritePadded(SDL_IOStream* io, const void* data, size_t size)
+{
+    static const Uint8 zeros[3] = { 0 };
+    size_t             pad = (4 - (size & 3)) & 3;
+
+    return SDL_WriteIO(io, data, size) == size && SDL_WriteIO(io, zeros, pad) == pad;
+}
+
+static int Write(const char* path)
+{
+    size_t        header_size = BUNDLE_HEADER_SIZE + (size_t)entry_count * BUNDLE_ENTRY_SIZE;
+    Uint8*        header = SDL_calloc(1, header_size);
+    Uint32        offset = (Uint32)((header_size + 3) & ~3u);
+    SDL_IOStream* io;
+    int           ok;
+
+    if (!header)
+    {
+        return false;
+    }
+    SDL_memcpy(header, "CBDL", 4);
+    header[4] = BUNDLE_VERSION;
+    PutU32(header + 8, (Uint32)entry_count);
+    for (int i = 0; i < entry_count; i++)
+    {
+        Uint8* p = header + BUNDLE_HEADER_SIZE + i * BUNDLE_ENTRY_SIZE;
+
+        SDL_memcpy(p, entries[i].name, BUNDLE_NAME_MAX);
+        PutU32(p + 16, (Uint32)entries[i].kind);
+        PutU32(p + 20, offset);
+        PutU32(p + 24, (Uint32)entries[i].size);
+        PutU16(p + 28, (Uint16)entries[i].width);
+        PutU16(p + 30, (Uint16)entries[i].height);
+        offset += (Uint32)((entries[i].size + 3) & ~(size_t)3);
+    }
+
+    io = SDL_IOFromFile(path, "wb");
+    if (!io)
+    {
+        SDL_Log("Couldn't write '%s': %s", path, SDL_GetError());
+        SDL_free(header);
+        return false;
+    }
+    ok = WritePadded(io, header, header_size);
+    for (int i = 0; ok && i < entry_count; i++)
+    {
+        ok = WritePadded(io, entries[i].data, entries[i].size);
+    }
+    ok = SDL_CloseIO(io) && ok;
+    SDL_free(header);
+
+    return ok;
+}
+
+int main(int argc, char* argv[])
+{
+    const char* dir = "data";
+    const char* output = NULL;
+    char        default_output[256];
+    char        path[256];
+    char        name[BUNDLE_NAME_MAX];
+    Bundle      bundle;
+    int         ok;
+    int         i;
+
+    for (i = 1; i < argc; i++)
+    {
+        if (!SDL_strcmp(argv[i], "-d") && i + 1 < argc)
+        {
+            dir = argv[++i];
+        }
+        else if (!SDL_strcmp(argv[i], "-o") && i + 1 < argc)
+        {
+            output = argv[++i];
+        }
+        else
+        {
+            SDL_Log("Usage: %s [-d data directory] [-o output]", argv[0]);
+            return 1;
+        }
+    }
+    if (!output)
+    {
+        SDL_snprintf(default_output, sizeof(default_output), "%s/%s", dir, BUNDLE_NAME);
+        output = default_output;
+    }
+
+    ok = AddFile(dir, "frame.bmp") && AddIndexed(dir, "gfx.bmp") && AddIndexed(dir, "font.bmp");
+    for (i = 0; ok && i < 64; i++)
+    {
+        SDL_snprintf(name, sizeof(name), "snd%d.wav", i);
+        SDL_snprintf(path, sizeof(path), "%s/%s", dir, name);
+        if (SDL_GetPathInfo(path, NULL))
+        {
+            ok = AddSound(path, name);
+        }
+    }
+    ok = ok && Write(output);
+
+    for (i = 0; i < entry_count; i++)
+    {
+        SDL_free(entries[i].data);
+    }
+    if (!ok)
+    {
+        SDL_Log("Couldn't make %s", output);
+        return 1;
+    }
+
+    if (!Bundle_Load(&bundle, output))
+    {
+        return 1;
+    }
+    SDL_Log("%s: %d entries, %u bytes", output, bundle.count, (unsigned)bundle.size);
+    Bundle_Free(&bundle);
+
+    return 0;
+}
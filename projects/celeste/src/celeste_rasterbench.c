@@ -0,0 +1,324 @@
+/* @file celeste_rasterbench.c
+ *
+ * A micro-benchmark for lines and filled circles.
+ *
+ * Draws the same lines and circles with the SDL3 frontend's former
+ * p8_line() and circfill(), which fill a rectangle per pixel or per
+ * piece of a circle with SDL_FillSurfaceRect(), and with raster.c,
+ * which clips once and stores straight into the surface.  Both are
+ * checked to leave the same pixels behind, then timed.  Circles larger
+ * than the game draws went through p8_line() before, which leaves out
+ * the end of each row, so those are timed but not compared.
+ *
+ * Usage: celeste_rasterbench [-n passes]
+ *
+ */
+
+#include <SDL3/SDL.h>
+#include "raster.h"
+
+#define RASTERBENCH_DEFAULT_PASSES 200
+#define RASTERBENCH_SHAPES         1024
+#define RASTERBENCH_SIZE           128
+
+typedef struct
+{
+    int x0, y0, x1, y1;
+
+} shape_t;
+
+typedef struct
+{
+    const char* name;
+    int         kind; // 0 line, 1 circle.
+    int         arg;  // Circle radius, or line direction: 0 vertical, 1 horizontal, 2 any.
+    int         compare;
+
+} raster_mode_t;
+
+static const raster_mode_t modes[] =
+{
+    { "line |",     0, 0, 1 },
+    { "line -",     0, 1, 1 },
+    { "line /",     0, 2, 1 },
+    { "circfill 1", 1, 1, 1 },
+    { "circfill 2", 1, 2, 1 },
+    { "circfill 3", 1, 3, 1 },
+    { "circfill 8", 1, 8, 0 },
+};
+
+static SDL_Surface* screen;
+
+// The frontend's p8_line() before raster.c.
+static void p8_line(int x0, int y0, int x1, int y1, unsigned char color)
+{
+    int sx, sy, dx, dy, err;
+    SDL_Rect rect;
+
+#define CLAMP(v,min,max) v = v < min ? min : v >= max ? max-1 : v;
+    CLAMP(x0, 0, screen->w);
+    CLAMP(y0, 0, screen->h);
+    CLAMP(x1, 0, screen->w);
+    CLAMP(y1, 0, screen->h);
+
+#undef CLAMP
+#define PLOT(xa, ya) \
+    rect.x = xa; \
+    rect.y = ya; \
+    rect.w = 1; \
+    rect.h = 1; \
+    do { \
+        SDL_FillSurfaceRect(screen, &rect, color); \
+    } \
+    while (0)
+    dx = SDL_abs(x1 - x0);
+    dy = SDL_abs(y1 - y0);
+    if (!dx && !dy)
+    {
+        return;
+    }
+
+    if (x0 < x1)
+    {
+        sx = 1;
+    }
+    else
+    {
+        sx = -1;
+    }
+    if (y0 < y1)
+    {
+        sy = 1;
+    }
+    else
+    {
+        sy = -1;
+    }
+    err = dx - dy;
+    if (!dy && !dx)
+    {
+        return;
+    }
+    else if (!dx) //vertical line
+    {
+        int y;
+        for (y = y0; y != y1; y += sy)
+        {
+            PLOT(x0, y);
+        }
+    }
+    else if (!dy) //horizontal line
+    {
+        int x;
+        for (x = x0; x != x1; x += sx)
+        {
+            PLOT(x, y0);
+        }
+    }
+
+    while (x0 != x1 || y0 != y1)
+    {
+        int e2;
+        PLOT(x0, y0);
+        e2 = 2 * err;
+        if (e2 > -dy)
+        {
+            err -= dy;
+            x0 += sx;
+        }
+        if (e2 < dx)
+        {
+            err += dx;
+            y0 += sy;
+        }
+    }
+#undef PLOT
+}
+
+// The frontend's emu_circfill() before raster.c.
+static void circfill(int cx, int cy, int r, int realcolor)
+{
+    if (r <= 1)
+    {
+        SDL_Rect rect_a = { cx - 1, cy, 3, 1 };
+        SDL_Rect rect_b = { cx, cy - 1, 1, 3 };
+
+        SDL_FillSurfaceRect(screen, &rect_a, realcolor);
+        SDL_FillSurfaceRect(screen, &rect_b, realcolor);
+    }
+    else if (r <= 2)
+    {
+        SDL_Rect rect_a = { cx - 2, cy - 1, 5, 3 };
+        SDL_Rect rect_b = { cx - 1, cy - 2, 3, 5 };
+
+        SDL_FillSurfaceRect(screen, &rect_a, realcolor);
+        SDL_FillSurfaceRect(screen, &rect_b, realcolor);
+    }
+    else if (r <= 3)
+    {
+        SDL_Rect rect_a = { cx - 3, cy - 1, 7, 3 };
+        SDL_Rect rect_b = { cx - 1, cy - 3, 3, 7 };
+        SDL_Rect rect_c = { cx - 2, cy - 2, 5, 5 };
+
+        SDL_FillSurfaceRect(screen, &rect_a, realcolor);
+        SDL_FillSurfaceRect(screen, &rect_b, realcolor);
+        SDL_FillSurfaceRect(screen, &rect_c, realcolor);
+    }
+    else
+    {
+        int f = 1 - r;
+        int ddFx = 1;
+        int ddFy = -2 * r;
+        int x = 0;
+        int y = r;
+
+        p8_line(cx, cy - y, cx, cy + r, realcolor);
+        p8_line(cx + r, cy, cx - r, cy, realcolor);
+
+        while (x < y)
+        {
+            if (f >= 0)
+            {
+                y--;
+                ddFy += 2;
+                f += ddFy;
+            }
+            x++;
+            ddFx += 2;
+            f += ddFx;
+
+            p8_line(cx + x, cy + y, cx - x, cy + y, realcolor);
+            p8_line(cx + x, cy - y, cx - x, cy - y, realcolor);
+            p8_line(cx + y, cy + x, cx - y, cy + x, realcolor);
+            p8_line(cx + y, cy - x, cx - y, cy - x, realcolor);
+        }
+    }
+}
+
+static void draw(const raster_mode_t* mode, const shape_t* shapes, int native)
+{
+    for (int i = 0; i < RASTERBENCH_SHAPES; i++)
+    {
+        const shape_t* s = &shapes[i];
+        Uint8          color = (Uint8)(1 + i % 15);
+
+        if (mode->kind == 1)
+        {
+            if (native)
+            {
+                Raster_Circfill(screen, 1, s->x0, s->y0, mode->arg, color, NULL);
+            }
+            else
+            {
+                circfill(s->x0, s->y0, mode->arg, color);
+            }
+        }
+        else if (native)
+        {
+            Raster_Line(screen, 1, s->x0, s->y0, s->x1, s->y1, color, NULL);
+        }
+        else
+        {
+            p8_line(s->x0, s->y0, s->x1, s->y1, color);
+        }
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    static shape_t shapes[RASTERBENCH_SHAPES];
+    static Uint8   expected[RASTERBENCH_SIZE * RASTERBENCH_SIZE];
+    Uint64 freq = SDL_GetPerformanceFrequency();
+    int    passes = RASTERBENCH_DEFAULT_PASSES;
+    int    mismatch = 0;
+    Uint64 seed = 0x2a;
+    size_t m;
+    int    i;
+
+    for (i = 1; i < argc; i++)
+    {
+        if (!SDL_strcmp(argv[i], "-n") && i + 1 < argc)
+        {
+            passes = SDL_atoi(argv[++i]);
+            if (passes <= 0)
+            {
+                SDL_Log("Pass count must be positive");
+                return 1;
+            }
+        }
+        else
+        {
+            SDL_Log("Usage: %s [-n passes]", argv[0]);
+            return 1;
+        }
+    }
+
+    screen = SDL_CreateSurface(RASTERBENCH_SIZE, RASTERBENCH_SIZE, SDL_PIXELFORMAT_INDEX8);
+    if (!screen)
+    {
+        SDL_Log("SDL_CreateSurface: %s", SDL_GetError());
+        return 1;
+    }
+
+    for (m = 0; m < SDL_arraysize(modes); m++)
+    {
+        const raster_mode_t* mode = &modes[m];
+        Uint64 t0, t1, t2;
+        int    p;
+
+        // Shapes a little past every edge of the screen, so clipping is measured too.
+        for (i = 0; i < RASTERBENCH_SHAPES; i++)
+        {
+            shape_t* s = &shapes[i];
+            int      length;
+
+            s->x0 = (int)(SDL_rand_r(&seed, RASTERBENCH_SIZE + 16)) - 8;
+            s->y0 = (int)(SDL_rand_r(&seed, RASTERBENCH_SIZE + 16)) - 8;
+            length = (int)SDL_rand_r(&seed, 48) - 24;
+            s->x1 = s->x0 + (mode->arg == 0 ? 0 : length);
+            s->y1 = s->y0 + (mode->arg == 1 ? 0 : mode->arg == 2 ? (int)SDL_rand_r(&seed, 48) - 24 : length);
+        }
+
+        if (mode->compare)
+        {
+            SDL_FillSurfaceRect(screen, NULL, 0);
+            draw(mode, shapes, 0);
+            for (i = 0; i < screen->h; i++)
+            {
+                SDL_memcpy(expected + i * RASTERBENCH_SIZE, (Uint8*)screen->pixels + i * screen->pitch, RASTERBENCH_SIZE);
+            }
+            SDL_FillSurfaceRect(screen, NULL, 0);
+            draw(mode, shapes, 1);
+            for (i = 0; i < screen->h; i++)
+            {
+                if (SDL_memcmp(expected + i * RASTERBENCH_SIZE, (Uint8*)screen->pixels + i * screen->pitch, RASTERBENCH_SIZE))
+                {
+                    SDL_Log("%s: raster.c differs from the old path at row %d", mode->name, i);
+                    mismatch = 1;
+                    break;
+                }
+            }
+        }
+
+        t0 = SDL_GetPerformanceCounter();
+        for (p = 0; p < passes; p++)
+        {
+            draw(mode, shapes, 0);
+        }
+        t1 = SDL_GetPerformanceCounter();
+        for (p = 0; p < passes; p++)
+        {
+            draw(mode, shapes, 1);
+        }
+        t2 = SDL_GetPerformanceCounter();
+
+        SDL_Log("%-10s old %7.1f ns, raster.c %7.1f ns, %5.2fx%s", mode->name,
+                (t1 - t0) * 1e9 / freq / passes / RASTERBENCH_SHAPES,
+                (t2 - t1) * 1e9 / freq / passes / RASTERBENCH_SHAPES,
+                (double)(t1 - t0) / (t2 - t1), mode->compare ? "" : " (not compared)");
+    }
+
+    SDL_DestroySurface(screen);
+
+    return mismatch ? 2 : 0;
+}
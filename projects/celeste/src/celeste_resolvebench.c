@@ -0,0 +1,173 @@
+/* @file celeste_resolvebench.c
+ *
+ * A micro-benchmark for turning the color indices the frontend draws
+ * into texture pixels.
+ *
+ * For each texture format resolve.c has a kernel for, converts the same
+ * frame of indices with a generic loop, which stores a pixel at a time
+ * and asks the pixel size as it goes, and with the kernel Resolve_Init()
+ * picks for the format.  Both are checked to write the same pixels, then
+ * timed over the whole screen and over rectangles the size of the dirty
+ * rectangles the frontend uploads, at odd and even x.
+ *
+ * Usage: celeste_resolvebench [-n passes]
+ *
+ */
+
+#include <SDL3/SDL.h>
+#include "palette.h"
+#include "resolve.h"
+
+#define RESOLVEBENCH_DEFAULT_PASSES 2000
+#define RESOLVEBENCH_RECTS          64
+#define RESOLVEBENCH_SIZE           128
+
+static const SDL_PixelFormat formats[] =
+{
+    SDL_PIXELFORMAT_XRGB4444,
+    SDL_PIXELFORMAT_RGB565,
+    SDL_PIXELFORMAT_XRGB8888,
+};
+
+static Uint8  indices[RESOLVEBENCH_SIZE * RESOLVEBENCH_SIZE];
+static Uint32 expected[RESOLVEBENCH_SIZE * RESOLVEBENCH_SIZE];
+static Uint32 pixels[RESOLVEBENCH_SIZE * RESOLVEBENCH_SIZE];
+
+// The same table for every format, with the pixel size checked per pixel.
+static void ResolveGeneric(const Resolve_Table* table, const Uint8* src, int src_pitch, Uint8* dst, int dst_pitch, int w, int h)
+{
+    for (int y = 0; y < h; y++, src += src_pitch, dst += dst_pitch)
+    {
+        for (int x = 0; x < w; x++)
+        {
+            Uint32 color = table->colors[src[x]];
+
+            switch (table->bpp)
+            {
+                case 2:  ((Uint16*)dst)[x] = (Uint16)color; break;
+                default: ((Uint32*)dst)[x] = color; break;
+            }
+        }
+    }
+}
+
+static void Run(const Resolve_Table* table, const SDL_Rect* rects, int count, Uint32* out, int generic)
+{
+    int pitch = RESOLVEBENCH_SIZE * table->bpp;
+
+    for (int i = 0; i < count; i++)
+    {
+        const SDL_Rect* r = &rects[i];
+        const Uint8*    src = indices + r->y * RESOLVEBENCH_SIZE + r->x;
+        Uint8*          dst = (Uint8*)out + r->y * pitch + r->x * table->bpp;
+
+        if (generic)
+        {
+            ResolveGeneric(table, src, RESOLVEBENCH_SIZE, dst, pitch, r->w, r->h);
+        }
+        else
+        {
+            Resolve_Rect(table, src, RESOLVEBENCH_SIZE, dst, pitch, r->w, r->h);
+        }
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    static SDL_Rect rects[RESOLVEBENCH_RECTS];
+    SDL_Rect full = { 0, 0, RESOLVEBENCH_SIZE, RESOLVEBENCH_SIZE };
+    Uint64   freq = SDL_GetPerformanceFrequency();
+    int      passes = RESOLVEBENCH_DEFAULT_PASSES;
+    int      mismatch = 0;
+    Uint64   seed = 0x2a;
+    long     rect_pixels = 0;
+    size_t   f;
+    int      i;
+
+    for (i = 1; i < argc; i++)
+    {
+        if (!SDL_strcmp(argv[i], "-n") && i + 1 < argc)
+        {
+            passes = SDL_atoi(argv[++i]);
+            if (passes <= 0)
+            {
+                SDL_Log("Pass count must be positive");
+                return 1;
+            }
+        }
+        else
+        {
+            SDL_Log("Usage: %s [-n passes]", argv[0]);
+            return 1;
+        }
+    }
+
+    // Runs of a color, like sprites and map tiles leave behind.
+    for (i = 0; i < RESOLVEBENCH_SIZE * RESOLVEBENCH_SIZE;)
+    {
+        int   run = 1 + (int)SDL_rand_r(&seed, 8);
+        Uint8 color = (Uint8)SDL_rand_r(&seed, 16);
+
+        for (; run > 0 && i < RESOLVEBENCH_SIZE * RESOLVEBENCH_SIZE; run--)
+        {
+            indices[i++] = color;
+        }
+    }
+    for (i = 0; i < RESOLVEBENCH_RECTS; i++)
+    {
+        rects[i].w = 1 + (int)SDL_rand_r(&seed, 40);
+        rects[i].h = 1 + (int)SDL_rand_r(&seed, 40);
+        rects[i].x = (int)SDL_rand_r(&seed, RESOLVEBENCH_SIZE - rects[i].w + 1);
+        rects[i].y = (int)SDL_rand_r(&seed, RESOLVEBENCH_SIZE - rects[i].h + 1);
+        rect_pixels += rects[i].w * rects[i].h;
+    }
+
+    for (f = 0; f < SDL_arraysize(formats); f++)
+    {
+        Resolve_Table table;
+        const char*   name = SDL_GetPixelFormatName(formats[f]);
+        int           shape;
+
+        if (!Resolve_Init(&table, formats[f], p8_palette))
+        {
+            return 1;
+        }
+        for (shape = 0; shape < 2; shape++)
+        {
+            const SDL_Rect* r = shape ? rects : &full;
+            int             count = shape ? RESOLVEBENCH_RECTS : 1;
+            long            work = shape ? rect_pixels : RESOLVEBENCH_SIZE * RESOLVEBENCH_SIZE;
+            Uint64          t0, t1, t2;
+            int             p;
+
+            SDL_memset(expected, 0, sizeof(expected));
+            SDL_memset(pixels, 0, sizeof(pixels));
+            Run(&table, r, count, expected, 1);
+            Run(&table, r, count, pixels, 0);
+            if (SDL_memcmp(expected, pixels, sizeof(pixels)))
+            {
+                SDL_Log("%s: the kernel differs from the generic loop", name);
+                mismatch = 1;
+            }
+
+            t0 = SDL_GetPerformanceCounter();
+            for (p = 0; p < passes; p++)
+            {
+                Run(&table, r, count, pixels, 1);
+            }
+            t1 = SDL_GetPerformanceCounter();
+            for (p = 0; p < passes; p++)
+            {
+                Run(&table, r, count, pixels, 0);
+            }
+            t2 = SDL_GetPerformanceCounter();
+
+            SDL_Log("%-24s %-6s generic %6.3f ns/pixel, kernel %6.3f ns/pixel, %5.2fx", name, shape ? "rects" : "screen",
+                    (t1 - t0) * 1e9 / freq / passes / work,
+                    (t2 - t1) * 1e9 / freq / passes / work,
+                    (double)(t1 - t0) / (t2 - t1));
+        }
+    }
+
+    return mismatch ? 2 : 0;
+}
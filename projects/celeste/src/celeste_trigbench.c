@@ -0,0 +1,126 @@
+/* @file celeste_trigbench.c
+ *
+ * A micro-benchmark and accuracy report for the PICO-8 sine.
+ *
+ * Compares the float path used by default, -sin(x * 2pi) in single
+ * precision, against the lookup table from p8sin.h that is used when
+ * CELESTE_P8_SINTABLE is defined.  Both are checked against the exact
+ * PICO-8 result (the true sine rounded to 16.16) at every one of the
+ * 65536 angles in a turn, then timed over a stream of angles shaped
+ * like the ones the game produces.
+ *
+ * Usage: celeste_trigbench [-n calls]
+ *
+ */
+
+#include <SDL3/SDL.h>
+#include "p8sin.h"
+
+#define TRIGBENCH_DEFAULT_CALLS 10000000
+#define TRIGBENCH_ANGLES        4096
+
+static float P8sin_float(float x)
+{
+    return -SDL_sinf(x * 6.2831853071796f);
+}
+
+static Sint32 P8sin_exact(Sint32 angle)
+{
+    return (Sint32)SDL_floor(-SDL_sin(angle * (3.14159265358979323846 * 2 / 65536)) * 65536 + 0.5);
+}
+
+typedef struct
+{
+    double max_error;
+    double sum_error;
+    int    inexact;
+
+} trig_error_t;
+
+static void add_error(trig_error_t* e, float result, Sint32 exact)
+{
+    double error = SDL_fabs(result - exact / 65536.0);
+
+    if (error > e->max_error)
+    {
+        e->max_error = error;
+    }
+    e->sum_error += error;
+    if ((Sint32)SDL_floor(result * 65536.0 + 0.5) != exact)
+    {
+        e->inexact++;
+    }
+}
+
+static void report_error(const char* name, const trig_error_t* e)
+{
+    SDL_Log("%s max error %.2e, mean error %.2e, %d/65536 not PICO-8 exact",
+            name, e->max_error, e->sum_error / 65536, e->inexact);
+}
+
+int main(int argc, char* argv[])
+{
+    static float angles[TRIGBENCH_ANGLES];
+    trig_error_t float_error = { 0 }, lut_error = { 0 };
+    Uint64       freq = SDL_GetPerformanceFrequency();
+    Uint64       t0, t1, t2;
+    int          calls = TRIGBENCH_DEFAULT_CALLS;
+    float        float_sum = 0, lut_sum = 0;
+    int          i;
+
+    for (i = 1; i < argc; i++)
+    {
+        if (!SDL_strcmp(argv[i], "-n") && i + 1 < argc)
+        {
+            calls = SDL_atoi(argv[++i]);
+            if (calls <= 0)
+            {
+                SDL_Log("Call count must be positive");
+                return 1;
+            }
+        }
+        else
+        {
+            SDL_Log("Usage: %s [-n calls]", argv[0]);
+            return 1;
+        }
+    }
+
+    P8sin_init_table();
+
+    for (i = 0; i < 65536; i++)
+    {
+        float  x = i / 65536.f;
+        Sint32 exact = P8sin_exact(i);
+
+        add_error(&float_error, P8sin_float(x), exact);
+        add_error(&lut_error, P8sin_lut(x), exact);
+    }
+
+    // Particle offsets, balloon and fly fruit steps, frames / 30: small
+    // positive and negative angles a few turns wide.
+    for (i = 0; i < TRIGBENCH_ANGLES; i++)
+    {
+        angles[i] = (float)((i * 2654435761u) >> 16) / 65536.f * 8 - 4;
+    }
+
+    t0 = SDL_GetPerformanceCounter();
+    for (i = 0; i < calls; i++)
+    {
+        float_sum += P8sin_float(angles[i & (TRIGBENCH_ANGLES - 1)]);
+    }
+    t1 = SDL_GetPerformanceCounter();
+    for (i = 0; i < calls; i++)
+    {
+        lut_sum += P8sin_lut(angles[i & (TRIGBENCH_ANGLES - 1)]);
+    }
+    t2 = SDL_GetPerformanceCounter();
+
+    report_error("float:", &float_error);
+    report_error("table:", &lut_error);
+    SDL_Log("float:  %.2f ns/call (sum %f)", (t1 - t0) * 1e9 / freq / calls, float_sum);
+    SDL_Log("table:  %.2f ns/call (sum %f)", (t2 - t1) * 1e9 / freq / calls, lut_sum);
+    SDL_Log("table:  %u bytes", (unsigned)sizeof(p8sin_table));
+
+    return 0;
+}
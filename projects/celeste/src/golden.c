@@ -0,0 +1,369 @@
+/* @file golden.c
+ *
+ * A C source port of the original Celeste game,
+ * highly optimized for the Nokia N-Gage.
+ *
+ * Original game by Maddy Makes Games.
+ * C source port by lemon32767.
+ *
+ * https://github.com/lemon32767/ccleste
+ *
+ */
+
+ /*
+  * Golden images.
+  * While a replay plays, every frame of the 8-bit screen is recorded, and
+  * a later run of the same replay is checked against the recording frame
+  * by frame.  Each frame is stored as its hash, which is what is compared,
+  * and as the XOR against the frame before it, so the expected image can
+  * be rebuilt and dumped next to the actual one at the first mismatch.
+  * The XOR is run length encoded as in rewind.c, pairs of "skip n
+  * unchanged bytes, then xor the next m bytes" where both counts are a
+  * single byte; a frame that didn't change takes no bytes at all.  The
+  * file is a 16 byte header followed by the frames:
+  *
+  *   0  "CGLD"           magic
+  *   4  u8 version, u8[3] reserved
+  *   8  u16 width, u16 height
+  *  12  u32 frame count
+  *  16  frames of
+  *        0  u32 hash, FNV-1a over the pixels, row by row
+  *        4  u32 size of the runs in bytes
+  *        8  runs of (u8 skip, u8 count, u8[count] xor)
+  *
+  * Numbers are little endian.
+  */
+
+#include "golden.h"
+
+#define GOLDEN_VERSION     1
+#define GOLDEN_HEADER_SIZE 16
+
+static int    width = 0, height = 0;
+static Uint8* frame = NULL; // The screen, without the pitch.
+static Uint8* last = NULL;  // The frame before, rebuilt from the recording when checking.
+static Uint8* data = NULL;  // The file, header included.
+static size_t data_size = 0, data_cap = 0;
+static size_t data_pos = 0; // Checking position in data.
+static Uint32 frames = 0;   // Recorded or checked so far.
+static Uint32 golden_frames = 0;
+static _Bool  checking = 0;
+
+static SDL_Color dump_palette[16];
+static char      dump_path[256];
+
+static void PutU16(Uint8* p, Uint16 v)
+{
+    p[0] = (Uint8)v;
+    p[1] = (Uint8)(v >> 8);
+}
+
+static void PutU32(Uint8* p, Uint32 v)
+{
+    p[0] = (Uint8)v;
+    p[1] = (Uint8)(v >> 8);
+    p[2] = (Uint8)(v >> 16);
+    p[3] = (Uint8)(v >> 24);
+}
+
+static Uint16 GetU16(const Uint8* p)
+{
+    return (Uint16)(p[0] | (p[1] << 8));
+}
+
+static Uint32 GetU32(const Uint8* p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((Uint32)p[3] << 24);
+}
+
+static Uint32 Hash(const Uint8* pixels, size_t size)
+{
+    Uint32 hash = 0x811c9dc5;
+
+    for (size_t i = 0; i < size; i++)
+    {
+        hash ^= pixels[i];
+        hash *= 0x01000193;
+    }
+    return hash;
+}
+
+void Golden_Stop(void)
+{
+    SDL_free(frame);
+    SDL_free(last);
+    SDL_free(data);
+    frame = last = data = NULL;
+    data_size = data_cap = data_pos = 0;
+    width = height = 0;
+    frames = golden_frames = 0;
+    checking = 0;
+}
+
+static int Start(int w, int h)
+{
+    width = w;
+    height = h;
+    frame = SDL_malloc((size_t)w * h);
+    last = SDL_calloc((size_t)w * h, 1);
+    if (!frame || !last)
+    {
+        SDL_Log("Out of memory for golden images");
+        Golden_Stop();
+        return false;
+    }
+    return true;
+}
+
+int Golden_StartRecording(int w, int h)
+{
+    Golden_Stop();
+    if (!Start(w, h))
+    {
+        return false;
+    }
+
+    data_cap = GOLDEN_HEADER_SIZE + 64 * 1024;
+    data = SDL_malloc(data_cap);
+    if (!data)
+    {
+        SDL_Log("Out of memory for golden images");
+        Golden_Stop();
+        return false;
+    }
+    data_size = GOLDEN_HEADER_SIZE;
+    return true;
+}
+
+int Golden_Save(const char* path)
+{
+    SDL_IOStream* io;
+    int           ok;
+
+    if (!data || checking)
+    {
+        return false;
+    }
+
+    SDL_memcpy(data, "CGLD", 4);
+    data[4] = GOLDEN_VERSION;
+    data[5] = data[6] = data[7] = 0;
+    PutU16(data + 8, (Uint16)width);
+    PutU16(data + 10, (Uint16)height);
+    PutU32(data + 12, frames);
+
+    io = SDL_IOFromFile(path, "wb");
+    if (!io)
+    {
+        SDL_Log("Couldn't write golden images '%s': %s", path, SDL_GetError());
+        return false;
+    }
+    ok = SDL_WriteIO(io, data, data_size) == data_size;
+    ok = SDL_CloseIO(io) && ok;
+    if (ok)
+    {
+        SDL_Log("golden images: %u frames in %u bytes written to %s", (unsigned)frames, (unsigned)data_size, path);
+    }
+    return ok;
+}
+
+int Golden_StartChecking(const char* path, const SDL_Color palette[16])
+{
+    Golden_Stop();
+    data = SDL_LoadFile(path, &data_size);
+    if (!data)
+    {
+        SDL_Log("Couldn't read golden images '%s': %s", path, SDL_GetError());
+        return false;
+    }
+    if (data_size < GOLDEN_HEADER_SIZE || SDL_memcmp(data, "CGLD", 4) || data[4] != GOLDEN_VERSION)
+    {
+        SDL_Log("'%s' is not a golden image recording", path);
+        Golden_Stop();
+        return false;
+    }
+    if (!Start(GetU16(data + 8), GetU16(data + 10)))
+    {
+        return false;
+    }
+
+    golden_frames = GetU32(data + 12);
+    data_pos = GOLDEN_HEADER_SIZE;
+    checking = 1;
+    SDL_memcpy(dump_palette, palette, sizeof(dump_palette));
+    SDL_strlcpy(dump_path, path, sizeof(dump_path));
+    return true;
+}
+
+int Golden_Checked(void)
+{
+    if (!checking)
+    {
+        return false;
+    }
+    if (frames != golden_frames)
+    {
+        SDL_Log("golden images: %u frames checked, the recording has %u", (unsigned)frames, (unsigned)golden_frames);
+        return false;
+    }
+    SDL_Log("golden images: all %u frames match", (unsigned)frames);
+    return true;
+}
+
+// Appends the runs turning last into frame, and makes frame the last.
+static int Encode(void)
+{
+    size_t size = (size_t)width * height;
+    size_t i = 0;
+    Uint8* out;
+
+    // Runs never take more than 2 bytes per pixel.
+    if (data_size + 8 + size * 2 > data_cap)
+    {
+        size_t grown_cap = SDL_max(data_cap * 2, data_size + 8 + size * 2);
+        Uint8* grown = SDL_realloc(data, grown_cap);
+
+        if (!grown)
+        {
+            SDL_Log("Out of memory for golden images, recording stopped");
+            return false;
+        }
+        data = grown;
+        data_cap = grown_cap;
+    }
+
+    out = data + data_size + 8;
+    while (i < size)
+    {
+        int skip = 0, count = 0;
+
+        while (i < size && skip < 255 && frame[i] == last[i])
+        {
+            i++;
+            skip++;
+        }
+        if (i == size)
+        {
+            break;
+        }
+        out[0] = (Uint8)skip;
+        while (i + count < size && count < 255 && frame[i + count] != last[i + count])
+        {
+            out[2 + count] = frame[i + count] ^ last[i + count];
+            count++;
+        }
+        out[1] = (Uint8)count;
+        out += 2 + count;
+        i += count;
+    }
+
+    PutU32(data + data_size, Hash(frame, size));
+    PutU32(data + data_size + 4, (Uint32)(out - data - data_size - 8));
+    data_size = out - data;
+    SDL_memcpy(last, frame, size);
+    return true;
+}
+
+// Applies the next frame's runs to last, and gives its hash.
+static int Decode(Uint32* hash)
+{
+    size_t       size = (size_t)width * height;
+    size_t       i = 0;
+    const Uint8* in;
+    const Uint8* end;
+
+    if (data_size - data_pos < 8 || GetU32(data + data_pos + 4) > data_size - data_pos - 8)
+    {
+        return false;
+    }
+    *hash = GetU32(data + data_pos);
+    in = data + data_pos + 8;
+    end = in + GetU32(data + data_pos + 4);
+    data_pos = end - data;
+
+    while (end - in >= 2)
+    {
+        int count = in[1];
+
+        i += in[0];
+        if (end - in - 2 < count || i > size || size - i < (size_t)count)
+        {
+            return false;
+        }
+        for (int j = 0; j < count; j++)
+        {
+            last[i + j] ^= in[2 + j];
+        }
+        in += 2 + count;
+        i += count;
+    }
+    return in == end;
+}
+
+static void Dump(const Uint8* pixels, const char* which)
+{
+    char         path[300];
+    SDL_Surface* surf = SDL_CreateSurfaceFrom(width, height, SDL_PIXELFORMAT_INDEX8, (void*)pixels, width);
+    SDL_Palette* palette = surf ? SDL_CreateSurfacePalette(surf) : NULL;
+
+    SDL_snprintf(path, sizeof(path), "%s.%u.%s.bmp", dump_path, (unsigned)frames, which);
+    if (!palette || !SDL_SetPaletteColors(palette, dump_palette, 0, 16) || !SDL_SaveBMP(surf, path))
+    {
+        SDL_Log("Couldn't write '%s': %s", path, SDL_GetError());
+    }
+    else
+    {
+        SDL_Log("%s frame written to %s", which, path);
+    }
+    SDL_DestroySurface(surf);
+}
+
+int Golden_Frame(const SDL_Surface* screen)
+{
+    size_t size = (size_t)width * height;
+    Uint32 hash;
+
+    if (!frame)
+    {
+        return false;
+    }
+    if (screen->w != width || screen->h != height)
+    {
+        SDL_Log("golden images: the screen is %dx%d, the recording %dx%d", screen->w, screen->h, width, height);
+        return false;
+    }
+    for (int y = 0; y < height; y++)
+    {
+        SDL_memcpy(frame + y * width, (const Uint8*)screen->pixels + y * screen->pitch, width);
+    }
+
+    if (!checking)
+    {
+        if (!Encode())
+        {
+            return false;
+        }
+        frames++;
+        return true;
+    }
+
+    if (frames == golden_frames)
+    {
+        SDL_Log("golden images: the recording ends at frame %u", (unsigned)frames);
+        return false;
+    }
+    if (!Decode(&hash))
+    {
+        SDL_Log("golden images: the recording is corrupt at frame %u", (unsigned)frames);
+        return false;
+    }
+    if (hash != Hash(frame, size))
+    {
+        SDL_Log("golden images: frame %u differs, %08x instead of %08x", (unsigned)frames, Hash(frame, size), hash);
+        Dump(last, "expected");
+        Dump(frame, "actual");
+        return false;
+    }
+    frames++;
+    return true;
+}
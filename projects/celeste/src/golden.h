@@ -0,0 +1,27 @@
+/* @file golden.h
+ *
+ * A C source port of the original Celeste game,
+ * highly optimized for the Nokia N-Gage.
+ *
+ * Original game by Maddy Makes Games.
+ * C source port by lemon32767.
+ *
+ * https://github.com/lemon32767/ccleste
+ *
+ */
+
+#ifndef GOLDEN_H
+#define GOLDEN_H
+
+#include <SDL3/SDL.h>
+
+int  Golden_StartRecording(int width, int height);
+int  Golden_Save(const char* path);
+
+int  Golden_StartChecking(const char* path, const SDL_Color palette[16]);
+int  Golden_Checked(void);
+
+int  Golden_Frame(const SDL_Surface* screen);
+void Golden_Stop(void);
+
+#endif // GOLDEN_H
@@ -20,8 +20,35 @@ SDL_Window* window;
 SDL_Renderer* renderer;
 
 // This function runs once at startup.
+// Usage: celeste [-p replay (-r | -c) golden images]
 SDL_AppResult SDL_AppInit(void** appstate, int argc, char* argv[])
 {
+    const char* replay = NULL;
+    const char* golden = NULL;
+    int         record = 0;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (!SDL_strcmp(argv[i], "-p") && i + 1 < argc)
+        {
+            replay = argv[++i];
+        }
+        else if ((!SDL_strcmp(argv[i], "-r") || !SDL_strcmp(argv[i], "-c")) && i + 1 < argc)
+        {
+            record = argv[i][1] == 'r';
+            golden = argv[++i];
+        }
+        else
+        {
+            break;
+        }
+    }
+    if (!replay != !golden)
+    {
+        SDL_Log("Usage: %s [-p replay (-r | -c) golden images]", argv[0]);
+        return SDL_APP_FAILURE;
+    }
+
     SDL_SetHint("SDL_RENDER_VSYNC", "1");
     SDL_SetLogPriorities(SDL_LOG_PRIORITY_INFO);
     SDL_SetAppMetadata("Celeste", "1.3", "com.example.ngagesdk");
@@ -38,7 +65,7 @@ SDL_AppResult SDL_AppInit(void** appstate, int argc, char* argv[])
         return SDL_APP_FAILURE;
     }
 
-    if (!Init())
+    if (!Init() || (replay && !StartGolden(replay, golden, record)))
     {
         return SDL_APP_FAILURE;
     }
@@ -57,14 +84,7 @@ SDL_AppResult SDL_AppEvent(void* appstate, SDL_Event* event)
 // This function runs once per frame, and is the heart of the program.
 SDL_AppResult SDL_AppIterate(void* appstate)
 {
-    if (!Iterate())
-    {
-        return SDL_APP_SUCCESS;
-    }
-    else
-    {
-        return SDL_APP_CONTINUE;
-    }
+    return Iterate();
 }
 
 // This function runs once at shutdown.
@@ -0,0 +1,65 @@
+/* @file p8sin.h
+ *
+ * A C source port of the original Celeste game,
+ * highly optimized for the Nokia N-Gage.
+ *
+ * Original game by Maddy Makes Games.
+ * C source port by lemon32767.
+ *
+ * https://github.com/lemon32767/ccleste
+ *
+ */
+
+ /*
+  * Table-driven PICO-8 sine.  PICO-8 angles are 16.16 numbers counted in
+  * turns, so there are exactly 65536 distinct angles per turn.  A quarter
+  * wave of 16.16 results is enough to answer every one of them; the other
+  * three quarters follow from symmetry.  Results are rounded to the nearest
+  * 1/65536 like a PICO-8 number, and PICO-8's sin() is inverted.
+  */
+
+#ifndef P8SIN_H_
+#define P8SIN_H_
+
+#define P8SIN_QUARTER 16384
+
+static Sint32 p8sin_table[P8SIN_QUARTER + 1];
+
+static void P8sin_init_table(void)
+{
+    int i;
+
+    if (p8sin_table[P8SIN_QUARTER])
+    {
+        return;
+    }
+    for (i = 0; i <= P8SIN_QUARTER; i++)
+    {
+        p8sin_table[i] = (Sint32)SDL_floor(SDL_sin(i * (3.14159265358979323846 / 2 / P8SIN_QUARTER)) * 65536 + 0.5);
+    }
+}
+
+// Takes the angle in 1/65536 turns, returns a 16.16 number.
+static inline Sint32 P8sin_fixed(Sint32 angle)
+{
+    int    i = angle & (P8SIN_QUARTER - 1);
+    Sint32 s;
+
+    if (angle & P8SIN_QUARTER)
+    {
+        i = P8SIN_QUARTER - i;
+    }
+    s = p8sin_table[i];
+    return (angle & (P8SIN_QUARTER * 2)) ? s : -s;
+}
+
+static inline float P8sin_lut(float x)
+{
+    float  f = x * 65536.f;
+    Sint32 angle = (Sint32)f;
+
+    angle -= f < angle; // Floor rather than truncate, without calling floorf().
+    return (float)P8sin_fixed(angle) * (1.f / 65536.f);
+}
+
+#endif
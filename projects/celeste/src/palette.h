@@ -0,0 +1,44 @@
+/* @file palette.h
+ *
+ * A C source port of the original Celeste game,
+ * highly optimized for the Nokia N-Gage.
+ *
+ * Original game by Maddy Makes Games.
+ * C source port by lemon32767.
+ *
+ * https://github.com/lemon32767/ccleste
+ *
+ */
+
+ /*
+  * The 16 PICO-8 colors, for the frontend, the asset packer and the
+  * benchmarks, which all have to match the sprite sheets to the same
+  * palette.
+  */
+
+#ifndef PALETTE_H
+#define PALETTE_H
+
+#include <SDL3/SDL.h>
+
+static const SDL_Color p8_palette[16] =
+{
+    { 0x00, 0x00, 0x00 },
+    { 0x1d, 0x2b, 0x53 },
+    { 0x7e, 0x25, 0x53 },
+    { 0x00, 0x87, 0x51 },
+    { 0xab, 0x52, 0x36 },
+    { 0x5f, 0x57, 0x4f },
+    { 0xc2, 0xc3, 0xc7 },
+    { 0xff, 0xf1, 0xe8 },
+    { 0xff, 0x00, 0x4d },
+    { 0xff, 0xa3, 0x00 },
+    { 0xff, 0xec, 0x27 },
+    { 0x00, 0xe4, 0x36 },
+    { 0x29, 0xad, 0xff },
+    { 0x83, 0x76, 0x9c },
+    { 0xff, 0x77, 0xa8 },
+    { 0xff, 0xcc, 0xaa }
+};
+
+#endif
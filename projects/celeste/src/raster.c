@@ -0,0 +1,238 @@
+/* @file raster.c
+ *
+ * A C source port of the original Celeste game,
+ * highly optimized for the Nokia N-Gage.
+ *
+ * Original game by Maddy Makes Games.
+ * C source port by lemon32767.
+ *
+ * https://github.com/lemon32767/ccleste
+ *
+ */
+
+ /*
+  * Lines and filled circles, written straight into an 8-bit surface of
+  * color indices.  Coordinates are PICO-8 pixels, each drawn as a square
+  * of scale by scale surface pixels.  Everything is clipped up front, so
+  * the loops store without checking: straight lines and circle rows are
+  * memsets, and other lines a Bresenham walk with no per pixel clipping.
+  * Scales 1 and 2 each get their own copy of the loops, inlined with the
+  * scale as a constant, so the multiplications fold away; other scales
+  * share a copy that multiplies as it goes.
+  */
+
+#include "raster.h"
+
+// Half the width of each row of a circle, from the middle row out.
+static Uint8 circle_table[RASTER_CIRCLE_TABLE + 1][RASTER_CIRCLE_TABLE + 1];
+
+// The midpoint circle, the rows it would fill of a circle of radius r.
+static void CircleSpans(int r, Uint8* half)
+{
+    int f = 1 - r;
+    int ddFx = 1;
+    int ddFy = -2 * r;
+    int x = 0;
+    int y = r;
+
+    SDL_memset(half, 0, r + 1);
+    half[0] = (Uint8)r;
+    while (x < y)
+    {
+        if (f >= 0)
+        {
+            y--;
+            ddFy += 2;
+            f += ddFy;
+        }
+        x++;
+        ddFx += 2;
+        f += ddFx;
+
+        half[y] = (Uint8)SDL_max(half[y], x);
+        half[x] = (Uint8)SDL_max(half[x], y);
+    }
+}
+
+// x, y, w and h must be within dst.
+SDL_FORCE_INLINE void Fill(SDL_Surface* dst, int scale, int x, int y, int w, int h, Uint8 color)
+{
+    Uint8* row = (Uint8*)dst->pixels + y * scale * dst->pitch + x * scale;
+
+    w *= scale;
+    for (h *= scale; h > 0; h--, row += dst->pitch)
+    {
+        // Most spans are a few pixels of a small circle or a vertical line,
+        // not worth a call to memset.
+        if (w <= 8)
+        {
+            for (int i = 0; i < w; i++)
+            {
+                row[i] = color;
+            }
+        }
+        else
+        {
+            SDL_memset(row, color, w);
+        }
+    }
+}
+
+SDL_FORCE_INLINE int Line(SDL_Surface* dst, int scale, int x0, int y0, int x1, int y1, Uint8 color, SDL_Rect* drawn)
+{
+    int w = dst->w / scale;
+    int h = dst->h / scale;
+    int dx, dy;
+
+    SDL_assert(SDL_BYTESPERPIXEL(dst->format) == 1);
+    x0 = SDL_clamp(x0, 0, w - 1);
+    y0 = SDL_clamp(y0, 0, h - 1);
+    x1 = SDL_clamp(x1, 0, w - 1);
+    y1 = SDL_clamp(y1, 0, h - 1);
+    dx = SDL_abs(x1 - x0);
+    dy = SDL_abs(y1 - y0);
+    if (!dx && !dy)
+    {
+        return false;
+    }
+
+    if (drawn)
+    {
+        drawn->x = SDL_min(x0, x1) * scale;
+        drawn->y = SDL_min(y0, y1) * scale;
+        drawn->w = (dx + 1) * scale;
+        drawn->h = (dy + 1) * scale;
+    }
+
+    if (!dx)
+    {
+        Fill(dst, scale, x0, y0 < y1 ? y0 : y1 + 1, 1, dy, color);
+    }
+    else if (!dy)
+    {
+        Fill(dst, scale, x0 < x1 ? x0 : x1 + 1, y0, dx, 1, color);
+    }
+    else
+    {
+        int    sx = x0 < x1 ? 1 : -1;
+        int    sy = y0 < y1 ? 1 : -1;
+        int    err = dx - dy;
+        Uint8* p = (Uint8*)dst->pixels + y0 * scale * dst->pitch + x0 * scale;
+
+        while (x0 != x1 || y0 != y1)
+        {
+            int e2 = 2 * err;
+
+            if (scale == 1)
+            {
+                *p = color;
+            }
+            else
+            {
+                Fill(dst, scale, x0, y0, 1, 1, color);
+            }
+            if (e2 > -dy)
+            {
+                err -= dy;
+                x0 += sx;
+                p += sx * scale;
+            }
+            if (e2 < dx)
+            {
+                err += dx;
+                y0 += sy;
+                p += sy * scale * dst->pitch;
+            }
+        }
+    }
+    return true;
+}
+
+// half holds the spans of a circle of radius r.
+SDL_FORCE_INLINE int Circfill(SDL_Surface* dst, int scale, int cx, int cy, int r, const Uint8* half, Uint8 color, SDL_Rect* drawn)
+{
+    int w = dst->w / scale;
+    int h = dst->h / scale;
+    int top, bottom, y;
+
+    top = SDL_max(cy - r, 0);
+    bottom = SDL_min(cy + r, h - 1);
+    if (cx + r < 0 || cx - r >= w || top > bottom)
+    {
+        return false;
+    }
+    for (y = top; y <= bottom; y++)
+    {
+        int hw = half[SDL_abs(y - cy)];
+        int left = SDL_max(cx - hw, 0);
+        int right = SDL_min(cx + hw, w - 1);
+
+        if (left <= right)
+        {
+            Fill(dst, scale, left, y, right - left + 1, 1, color);
+        }
+    }
+
+    if (drawn)
+    {
+        drawn->x = SDL_max(cx - r, 0) * scale;
+        drawn->y = top * scale;
+        drawn->w = (SDL_min(cx + r, w - 1) + 1) * scale - drawn->x;
+        drawn->h = (bottom - top + 1) * scale;
+    }
+    return true;
+}
+
+// Like the frontend always has, end points are clamped to the surface and
+// the last point of the line isn't drawn.
+int Raster_Line(SDL_Surface* dst, int scale, int x0, int y0, int x1, int y1, Uint8 color, SDL_Rect* drawn)
+{
+    switch (scale)
+    {
+        case 1:
+            return Line(dst, 1, x0, y0, x1, y1, color, drawn);
+        case 2:
+            return Line(dst, 2, x0, y0, x1, y1, color, drawn);
+        default:
+            return Line(dst, scale, x0, y0, x1, y1, color, drawn);
+    }
+}
+
+// Radii below 1 draw like 1, as they always have in this port.
+int Raster_Circfill(SDL_Surface* dst, int scale, int cx, int cy, int r, Uint8 color, SDL_Rect* drawn)
+{
+    static int ready = 0;
+    Uint8 spans[RASTER_CIRCLE_MAX + 1];
+    const Uint8* half;
+
+    SDL_assert(SDL_BYTESPERPIXEL(dst->format) == 1);
+    if (!ready)
+    {
+        for (int i = 1; i <= RASTER_CIRCLE_TABLE; i++)
+        {
+            CircleSpans(i, circle_table[i]);
+        }
+        ready = 1;
+    }
+
+    r = SDL_clamp(r, 1, RASTER_CIRCLE_MAX);
+    if (r <= RASTER_CIRCLE_TABLE)
+    {
+        half = circle_table[r];
+    }
+    else
+    {
+        CircleSpans(r, spans);
+        half = spans;
+    }
+
+    switch (scale)
+    {
+        case 1:
+            return Circfill(dst, 1, cx, cy, r, half, color, drawn);
+        case 2:
+            return Circfill(dst, 2, cx, cy, r, half, color, drawn);
+        default:
+            return Circfill(dst, scale, cx, cy, r, half, color, drawn);
+    }
+}
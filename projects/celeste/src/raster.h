@@ -0,0 +1,26 @@
+/* @file raster.h
+ *
+ * A C source port of the original Celeste game,
+ * highly optimized for the Nokia N-Gage.
+ *
+ * Original game by Maddy Makes Games.
+ * C source port by lemon32767.
+ *
+ * https://github.com/lemon32767/ccleste
+ *
+ */
+
+#ifndef RASTER_H
+#define RASTER_H
+
+#include <SDL3/SDL.h>
+
+// Radii of the circles kept as span tables, larger ones are worked out per
+// call, up to the largest drawn.
+#define RASTER_CIRCLE_TABLE 8
+#define RASTER_CIRCLE_MAX   255
+
+int Raster_Line(SDL_Surface* dst, int scale, int x0, int y0, int x1, int y1, Uint8 color, SDL_Rect* drawn);
+int Raster_Circfill(SDL_Surface* dst, int scale, int cx, int cy, int r, Uint8 color, SDL_Rect* drawn);
+
+#endif // RASTER_H
@@ -0,0 +1,228 @@
+/* @file replay.c
+ *
+ * A C source port of the original Celeste game,
+ * highly optimized for the Nokia N-Gage.
+ *
+ * Original game by Maddy Makes Games.
+ * C source port by lemon32767.
+ *
+ * https://github.com/lemon32767/ccleste
+ *
+ */
+
+ /*
+  * Input recordings.
+  * Given the seed, the game plays out the same way for the same buttons,
+  * so a replay is the seed plus the button bitmask of every frame.  The
+  * file is a 28 byte header followed by the buttons as runs:
+  *
+  *   0  "CRPL"           magic
+  *   4  u8 version, u8[3] reserved
+  *   8  u32 seed
+  *  12  u32 initial state hash
+  *  16  u32 final state hash
+  *  20  u32 frame count
+  *  24  u32 size of the runs in bytes
+  *  28  runs of (u8 frame count, u8 buttons)
+  *
+  * Numbers are little endian.  The state hashes are FNV-1a over the save
+  * state, so a replay also tells whether another build still plays it out
+  * the same way.
+  */
+
+#include <stdio.h>
+#include "replay.h"
+#include "celeste.h"
+
+#define REPLAY_VERSION     1
+#define REPLAY_HEADER_SIZE 28
+
+static Replay_Header header;
+static Uint8*        runs = NULL;
+static size_t        runs_size = 0, runs_cap = 0;
+static size_t        run_pos = 0;   // Playback position in runs.
+static int           run_frame = 0; // Frames of the current run already played.
+
+Uint32 Replay_HashState(void)
+{
+    size_t size = Celeste_P8_get_state_size();
+    Uint8* state = SDL_malloc(size);
+    Uint32 hash = 0x811c9dc5;
+    size_t i;
+
+    if (!state)
+    {
+        return 0;
+    }
+    Celeste_P8_save_state(state);
+    for (i = 0; i < size; i++)
+    {
+        hash ^= state[i];
+        hash *= 0x01000193;
+    }
+    SDL_free(state);
+
+    return hash;
+}
+
+void Replay_Stop(void)
+{
+    SDL_free(runs);
+    runs = NULL;
+    runs_size = runs_cap = 0;
+    run_pos = 0;
+    run_frame = 0;
+}
+
+int Replay_StartRecording(unsigned seed)
+{
+    Replay_Stop();
+    header.seed = seed;
+    header.initial_hash = Replay_HashState();
+    header.final_hash = 0;
+    header.frames = 0;
+
+    runs_cap = 1024;
+    runs = SDL_malloc(runs_cap);
+    if (!runs)
+    {
+        runs_cap = 0;
+        SDL_Log("Out of memory for replay");
+        return 0;
+    }
+    return 1;
+}
+
+void Replay_RecordFrame(Uint16 buttons)
+{
+    if (!runs)
+    {
+        return;
+    }
+
+    header.frames++;
+    if (runs_size && runs[runs_size - 1] == (Uint8)buttons && runs[runs_size - 2] < 255)
+    {
+        runs[runs_size - 2]++;
+        return;
+    }
+
+    if (runs_size + 2 > runs_cap)
+    {
+        Uint8* grown = SDL_realloc(runs, runs_cap * 2);
+        if (!grown)
+        {
+            SDL_Log("Out of memory for replay, recording stopped");
+            Replay_Stop();
+            return;
+        }
+        runs = grown;
+        runs_cap *= 2;
+    }
+    runs[runs_size++] = 1;
+    runs[runs_size++] = (Uint8)buttons;
+}
+
+static void PutU32(Uint8* p, Uint32 v)
+{
+    p[0] = (Uint8)v;
+    p[1] = (Uint8)(v >> 8);
+    p[2] = (Uint8)(v >> 16);
+    p[3] = (Uint8)(v >> 24);
+}
+
+static Uint32 GetU32(const Uint8* p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((Uint32)p[3] << 24);
+}
+
+int Replay_Save(const char* path)
+{
+    Uint8 head[REPLAY_HEADER_SIZE] = { 'C', 'R', 'P', 'L', REPLAY_VERSION };
+    FILE* file;
+    int   ok;
+
+    if (!runs)
+    {
+        return 0;
+    }
+
+    header.final_hash = Replay_HashState();
+    PutU32(head + 8, header.seed);
+    PutU32(head + 12, header.initial_hash);
+    PutU32(head + 16, header.final_hash);
+    PutU32(head + 20, header.frames);
+    PutU32(head + 24, (Uint32)runs_size);
+
+    file = fopen(path, "wb");
+    if (!file)
+    {
+        SDL_Log("Couldn't write replay '%s'", path);
+        return 0;
+    }
+    ok = fwrite(head, sizeof(head), 1, file) == 1 && (!runs_size || fwrite(runs, runs_size, 1, file) == 1);
+    fclose(file);
+
+    return ok;
+}
+
+int Replay_Load(const char* path, Replay_Header* out)
+{
+    Uint8 head[REPLAY_HEADER_SIZE];
+    FILE* file;
+    int   ok;
+
+    Replay_Stop();
+
+    file = fopen(path, "rb");
+    if (!file)
+    {
+        SDL_Log("Couldn't read replay '%s'", path);
+        return 0;
+    }
+    if (fread(head, sizeof(head), 1, file) != 1 || SDL_memcmp(head, "CRPL", 4) || head[4] != REPLAY_VERSION)
+    {
+        SDL_Log("'%s' is not a replay", path);
+        fclose(file);
+        return 0;
+    }
+
+    header.seed = GetU32(head + 8);
+    header.initial_hash = GetU32(head + 12);
+    header.final_hash = GetU32(head + 16);
+    header.frames = GetU32(head + 20);
+    runs_size = GetU32(head + 24);
+
+    runs_cap = runs_size ? runs_size : 1;
+    runs = SDL_malloc(runs_cap);
+    ok = runs && (!runs_size || fread(runs, runs_size, 1, file) == 1) && !(runs_size & 1);
+    fclose(file);
+    if (!ok)
+    {
+        SDL_Log("Replay '%s' is truncated", path);
+        Replay_Stop();
+        return 0;
+    }
+
+    if (out)
+    {
+        *out = header;
+    }
+    return 1;
+}
+
+int Replay_NextFrame(Uint16* buttons)
+{
+    if (!runs || run_pos >= runs_size)
+    {
+        return 0;
+    }
+
+    *buttons = runs[run_pos + 1];
+    if (++run_frame >= runs[run_pos])
+    {
+        run_frame = 0;
+        run_pos += 2;
+    }
+    return 1;
+}
@@ -0,0 +1,38 @@
+/* @file replay.h
+ *
+ * A C source port of the original Celeste game,
+ * highly optimized for the Nokia N-Gage.
+ *
+ * Original game by Maddy Makes Games.
+ * C source port by lemon32767.
+ *
+ * https://github.com/lemon32767/ccleste
+ *
+ */
+
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include <SDL3/SDL.h>
+
+typedef struct
+{
+    unsigned seed;         // Passed to Celeste_P8_set_rndseed() before Celeste_P8_init().
+    Uint32   initial_hash; // Replay_HashState() right after Celeste_P8_init().
+    Uint32   final_hash;   // Replay_HashState() after the last frame.
+    Uint32   frames;
+
+} Replay_Header;
+
+Uint32 Replay_HashState(void);
+
+int  Replay_StartRecording(unsigned seed);
+void Replay_RecordFrame(Uint16 buttons);
+int  Replay_Save(const char* path);
+
+int  Replay_Load(const char* path, Replay_Header* header);
+int  Replay_NextFrame(Uint16* buttons);
+
+void Replay_Stop(void);
+
+#endif // REPLAY_H
@@ -0,0 +1,134 @@
+/* @file resolve.c
+ *
+ * A C source port of the original Celeste game,
+ * highly optimized for the Nokia N-Gage.
+ *
+ * Original game by Maddy Makes Games.
+ * C source port by lemon32767.
+ *
+ * https://github.com/lemon32767/ccleste
+ *
+ */
+
+ /*
+  * Turns PICO-8 color indices into texture pixels.  There is a kernel per
+  * size of pixel, picked once when the table is built, so the loops never
+  * ask what format they write.  16-bit formats go two pixels at a time: a
+  * pair of indices looks up both pixels as one 32-bit word, which halves
+  * the stores on the N-Gage's ARM9, and indices are read four to a load.
+  * 32-bit formats are a store per pixel.
+  */
+
+#include "resolve.h"
+
+static const SDL_PixelFormat supported[] =
+{
+    SDL_PIXELFORMAT_XRGB4444,
+    SDL_PIXELFORMAT_RGB565,
+    SDL_PIXELFORMAT_XRGB8888,
+};
+
+static void Resolve16(const Resolve_Table* table, const Uint8* src, int src_pitch, Uint8* dst, int dst_pitch, int w, int h)
+{
+    for (; h > 0; h--, src += src_pitch, dst += dst_pitch)
+    {
+        const Uint8* s = src;
+        const Uint8* end = src + w;
+        Uint16*      d = (Uint16*)dst;
+
+        // Pairs are stored as whole words, so start on one.
+        if (((uintptr_t)d & 2) && s < end)
+        {
+            *d++ = (Uint16)table->colors[*s++];
+        }
+        for (; end - s >= 4; s += 4, d += 4)
+        {
+            Uint32 four;
+
+            SDL_memcpy(&four, s, 4);
+            four = SDL_Swap32LE(four);
+            ((Uint32*)d)[0] = table->pairs[(four & 0x0f) | (four >> 4 & 0xf0)];
+            ((Uint32*)d)[1] = table->pairs[(four >> 16 & 0x0f) | (four >> 20 & 0xf0)];
+        }
+        for (; end - s >= 2; s += 2, d += 2)
+        {
+            *(Uint32*)d = table->pairs[s[0] | s[1] << 4];
+        }
+        if (s < end)
+        {
+            *d = (Uint16)table->colors[*s];
+        }
+    }
+}
+
+static void Resolve32(const Resolve_Table* table, const Uint8* src, int src_pitch, Uint8* dst, int dst_pitch, int w, int h)
+{
+    for (; h > 0; h--, src += src_pitch, dst += dst_pitch)
+    {
+        Uint32* d = (Uint32*)dst;
+
+        for (int x = 0; x < w; x++)
+        {
+            d[x] = table->colors[src[x]];
+        }
+    }
+}
+
+int Resolve_Supported(SDL_PixelFormat format)
+{
+    for (size_t i = 0; i < SDL_arraysize(supported); i++)
+    {
+        if (supported[i] == format)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+int Resolve_Init(Resolve_Table* table, SDL_PixelFormat format, const SDL_Color palette[16])
+{
+    const SDL_PixelFormatDetails* details;
+
+    SDL_memset(table, 0, sizeof(*table));
+    if (!Resolve_Supported(format))
+    {
+        SDL_Log("No resolve kernel for %s", SDL_GetPixelFormatName(format));
+        return false;
+    }
+    details = SDL_GetPixelFormatDetails(format);
+    if (!details)
+    {
+        SDL_Log("SDL_GetPixelFormatDetails: %s", SDL_GetError());
+        return false;
+    }
+
+    table->format = format;
+    table->bpp = SDL_BYTESPERPIXEL(format);
+    for (int i = 0; i < 16; i++)
+    {
+        table->colors[i] = SDL_MapRGB(details, NULL, palette[i].r, palette[i].g, palette[i].b);
+    }
+    if (table->bpp == 2)
+    {
+        // Laid out as the two pixels are in memory, whatever the byte order.
+        for (int i = 0; i < 256; i++)
+        {
+            Uint16 two[2] = { (Uint16)table->colors[i & 15], (Uint16)table->colors[i >> 4] };
+
+            SDL_memcpy(&table->pairs[i], two, sizeof(two));
+        }
+        table->kernel = Resolve16;
+    }
+    else
+    {
+        table->kernel = Resolve32;
+    }
+    return true;
+}
+
+// dst must be aligned to its pixel size.
+void Resolve_Rect(const Resolve_Table* table, const Uint8* src, int src_pitch, void* dst, int dst_pitch, int w, int h)
+{
+    table->kernel(table, src, src_pitch, (Uint8*)dst, dst_pitch, w, h);
+}
@@ -0,0 +1,36 @@
+/* @file resolve.h
+ *
+ * A C source port of the original Celeste game,
+ * highly optimized for the Nokia N-Gage.
+ *
+ * Original game by Maddy Makes Games.
+ * C source port by lemon32767.
+ *
+ * https://github.com/lemon32767/ccleste
+ *
+ */
+
+#ifndef RESOLVE_H
+#define RESOLVE_H
+
+#include <SDL3/SDL.h>
+
+typedef struct Resolve_Table Resolve_Table;
+
+typedef void (*Resolve_Kernel)(const Resolve_Table* table, const Uint8* src, int src_pitch, Uint8* dst, int dst_pitch, int w, int h);
+
+struct Resolve_Table
+{
+    SDL_PixelFormat format;
+    int             bpp;
+    Uint32          colors[16]; // Each color index in format.
+    Uint32          pairs[256]; // Two 16-bit pixels per pair of indices, first | second << 4.
+    Resolve_Kernel  kernel;     // Picked for format by Resolve_Init().
+
+};
+
+int  Resolve_Supported(SDL_PixelFormat format);
+int  Resolve_Init(Resolve_Table* table, SDL_PixelFormat format, const SDL_Color palette[16]);
+void Resolve_Rect(const Resolve_Table* table, const Uint8* src, int src_pitch, void* dst, int dst_pitch, int w, int h);
+
+#endif // RESOLVE_H
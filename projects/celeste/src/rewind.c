@@ -0,0 +1,309 @@
+/* @file rewind.c
+ *
+ * A C source port of the original Celeste game,
+ * highly optimized for the Nokia N-Gage.
+ *
+ * Original game by Maddy Makes Games.
+ * C source port by lemon32767.
+ *
+ * https://github.com/lemon32767/ccleste
+ *
+ */
+
+ /*
+  * Rewind history for the game state.
+  * Every pushed frame is stored either as a keyframe, a plain copy of the
+  * save state, or as the XOR of the state against the frame pushed before
+  * it, run length encoded: pairs of "skip n unchanged bytes, then xor the
+  * next m bytes" where both counts are a single byte.  Consecutive frames
+  * differ in a few hundred bytes, mostly particles, so a delta is small
+  * compared to the state, and since XOR undoes itself the same delta steps
+  * back from the newer frame to the older one.  Records live in one buffer
+  * allocated up front and are evicted oldest first, a keyframe together
+  * with all of its deltas, so the history never grows past the budget
+  * given to Rewind_Init().
+  */
+
+#include "rewind.h"
+#include "celeste.h"
+
+typedef struct
+{
+    Uint32 offset, size;
+    Uint32 key; // Sequence number of the keyframe this record is relative to.
+
+} rewind_record;
+
+static Uint8*         arena = NULL;
+static size_t         arena_size = 0;
+static rewind_record* records = NULL;
+static Uint32         record_cap = 0;
+static Uint32         first = 0, count = 0; // Sequence numbers of the records held.
+static size_t         used = 0;
+
+static size_t state_size = 0;
+static Uint8* state = NULL; // Scratch for save/load.
+static Uint8* last = NULL;  // The state of the newest record.
+static Uint8* delta = NULL; // Scratch for encoding, worst case size.
+static int    interval = 1;
+static int    since_key = 0;
+
+static Rewind_Stats stats;
+
+#define RECORD(seq) records[(seq) % record_cap]
+
+int Rewind_Init(size_t budget, int keyframe_interval)
+{
+    state_size = Celeste_P8_get_state_size();
+    if (budget < state_size || keyframe_interval < 1)
+    {
+        SDL_Log("Rewind budget of %u bytes can't hold a single state", (unsigned)budget);
+        return false;
+    }
+
+    // The smallest record is an unchanged state: 2 bytes per 255 skipped.
+    record_cap = (Uint32)(budget / (state_size / 255 * 2 + 2)) + 1;
+
+    arena = SDL_malloc(budget);
+    records = SDL_malloc(record_cap * sizeof(*records));
+    state = SDL_malloc(state_size);
+    last = SDL_malloc(state_size);
+    delta = SDL_malloc(state_size + (state_size / 255 + 1) * 2);
+    if (!arena || !records || !state || !last || !delta)
+    {
+        SDL_Log("Out of memory for rewind");
+        Rewind_Destroy();
+        return false;
+    }
+
+    arena_size = budget;
+    interval = keyframe_interval;
+    Rewind_Clear();
+    SDL_memset(&stats, 0, sizeof(stats));
+
+    return true;
+}
+
+void Rewind_Clear(void)
+{
+    first = count = 0;
+    used = 0;
+    since_key = 0;
+}
+
+static void EvictOldest(void)
+{
+    // Deltas are useless without their keyframe, so they go with it.
+    do
+    {
+        used -= RECORD(first).size;
+        first++;
+        count--;
+    } while (count && RECORD(first).key != first);
+}
+
+// Finds room for size contiguous bytes after the newest record.
+static size_t Allocate(size_t size)
+{
+    for (;;)
+    {
+        size_t tail, head;
+
+        if (!count)
+        {
+            return 0;
+        }
+        if (count == record_cap)
+        {
+            EvictOldest();
+            continue;
+        }
+
+        tail = RECORD(first).offset;
+        head = RECORD(first + count - 1).offset + RECORD(first + count - 1).size;
+        if (RECORD(first + count - 1).offset >= tail)
+        {
+            // Records occupy [tail, head).
+            if (arena_size - head >= size)
+            {
+                return head;
+            }
+            if (tail >= size)
+            {
+                return 0;
+            }
+        }
+        else if (tail - head >= size)
+        {
+            // Records wrapped around and occupy [tail, end) and [0, head).
+            return head;
+        }
+        EvictOldest();
+    }
+}
+
+static size_t Encode(const Uint8* prev)
+{
+    Uint8* out = delta;
+    size_t i = 0;
+
+    while (i < state_size)
+    {
+        size_t skip = 0, len = 0;
+
+        while (i < state_size && skip < 255 && state[i] == prev[i])
+        {
+            skip++, i++;
+        }
+        // Gaps of up to two unchanged bytes are cheaper to xor than to skip.
+        while (i + len < state_size && len < 255 &&
+               (state[i + len] != prev[i + len] ||
+                (i + len + 1 < state_size && state[i + len + 1] != prev[i + len + 1]) ||
+                (i + len + 2 < state_size && state[i + len + 2] != prev[i + len + 2])))
+        {
+            out[2 + len] = state[i + len] ^ prev[i + len];
+            len++;
+        }
+        if (!len && i == state_size)
+        {
+            break; // Trailing unchanged bytes need no pairs.
+        }
+        out[0] = (Uint8)skip;
+        out[1] = (Uint8)len;
+        out += 2 + len;
+        i += len;
+    }
+    return out - delta;
+}
+
+// Turns the state after r into the state before it, or the other way round.
+static void ApplyDelta(const rewind_record* r, Uint8* dst)
+{
+    const Uint8* in = arena + r->offset;
+    const Uint8* end = in + r->size;
+    size_t       i = 0;
+
+    while (in < end)
+    {
+        int len = in[1];
+
+        i += in[0];
+        in += 2;
+        while (len--)
+        {
+            dst[i++] ^= *in++;
+        }
+    }
+}
+
+static void Append(const void* data, size_t size, bool keyframe)
+{
+    Uint32         seq = first + count;
+    size_t         offset = Allocate(size);
+    rewind_record* r = &RECORD(seq);
+
+    r->offset = (Uint32)offset;
+    r->size = (Uint32)size;
+    r->key = keyframe ? seq : RECORD(seq - 1).key;
+    SDL_memcpy(arena + offset, data, size);
+    count++;
+    used += size;
+
+    stats.pushed++;
+    stats.pushed_bytes += size;
+    if (keyframe)
+    {
+        stats.keyframes++;
+    }
+}
+
+void Rewind_Push(void)
+{
+    if (!arena)
+    {
+        return;
+    }
+
+    Celeste_P8_save_state(state);
+
+    if (count && since_key < interval - 1)
+    {
+        size_t size = Encode(last);
+
+        if (size < state_size)
+        {
+            Allocate(size);
+            // Making room may have evicted the keyframe itself.
+            if (count)
+            {
+                Append(delta, size, false);
+                SDL_memcpy(last, state, state_size);
+                since_key++;
+                return;
+            }
+        }
+    }
+
+    Append(state, state_size, true);
+    SDL_memcpy(last, state, state_size);
+    since_key = 0;
+}
+
+int Rewind_Step(void)
+{
+    const rewind_record* r;
+
+    if (!arena || count < 2)
+    {
+        return false;
+    }
+
+    // The newest record is the frame on screen, go to the one before it.
+    r = &RECORD(first + count - 1);
+    if (r->key != first + count - 1)
+    {
+        ApplyDelta(r, last);
+    }
+    else
+    {
+        // Crossing a keyframe: replay the previous group up to its end.
+        Uint32 seq = RECORD(first + count - 2).key;
+
+        SDL_memcpy(last, arena + RECORD(seq).offset, state_size);
+        while (++seq < first + count - 1)
+        {
+            ApplyDelta(&RECORD(seq), last);
+        }
+    }
+    count--;
+    used -= r->size;
+    since_key = (int)(first + count - 1 - RECORD(first + count - 1).key);
+    Celeste_P8_load_state(last);
+
+    return true;
+}
+
+void Rewind_GetStats(Rewind_Stats* st)
+{
+    SDL_assert(st != NULL);
+    *st = stats;
+    st->frames = (int)count;
+    st->used = used;
+}
+
+void Rewind_Destroy(void)
+{
+    SDL_free(arena);
+    SDL_free(records);
+    SDL_free(state);
+    SDL_free(last);
+    SDL_free(delta);
+    arena = NULL;
+    records = NULL;
+    state = NULL;
+    last = NULL;
+    delta = NULL;
+    arena_size = 0;
+    record_cap = 0;
+    first = count = 0;
+}
@@ -0,0 +1,35 @@
+/* @file rewind.h
+ *
+ * A C source port of the original Celeste game,
+ * highly optimized for the Nokia N-Gage.
+ *
+ * Original game by Maddy Makes Games.
+ * C source port by lemon32767.
+ *
+ * https://github.com/lemon32767/ccleste
+ *
+ */
+
+#ifndef REWIND_H
+#define REWIND_H
+
+#include <SDL3/SDL.h>
+
+typedef struct
+{
+    int    frames;       // Frames that can currently be rewound.
+    size_t used;         // Bytes of the budget holding them.
+    Uint64 pushed;       // Frames pushed since Rewind_Init().
+    Uint64 pushed_bytes; // Bytes written for those frames.
+    Uint64 keyframes;    // How many of those frames were keyframes.
+
+} Rewind_Stats;
+
+int Rewind_Init(size_t budget, int keyframe_interval);
+void Rewind_Push(void);
+int Rewind_Step(void);
+void Rewind_Clear(void);
+void Rewind_GetStats(Rewind_Stats* stats);
+void Rewind_Destroy(void);
+
+#endif // REWIND_H
@@ -0,0 +1,338 @@
+/* @file sprite.c
+ *
+ * A C source port of the original Celeste game,
+ * highly optimized for the Nokia N-Gage.
+ *
+ * Original game by Maddy Makes Games.
+ * C source port by lemon32767.
+ *
+ * https://github.com/lemon32767/ccleste
+ *
+ */
+
+ /*
+  * Span-encoded sprite sheets.
+  * Color 0 is transparent, so a sprite row is a few runs of opaque pixels
+  * with holes between them.  A sheet stores every row of every tile as
+  * those runs, each with a copy of its colors, so drawing a tile is a
+  * copy per run instead of a test per pixel.  Runs can be stored a second
+  * time for the horizontally flipped tile, with the colors reversed;
+  * vertical flips just walk the rows backwards.  A sheet that is only ever
+  * drawn in a solid color, like the font, can leave out the colors and
+  * keep just the runs.
+  */
+
+#include "sprite.h"
+
+SDL_Surface* Sprite_LoadIndexed(const char* path, int scale, const SDL_Color palette[16])
+{
+    SDL_Surface* bmp;
+    SDL_Surface* surf;
+    Uint8* data;
+
+    bmp = SDL_LoadBMP(path);
+    if (!bmp)
+    {
+        SDL_Log("Error loading bmp '%s': %s", path, SDL_GetError());
+        return NULL;
+    }
+
+    // Images are kept as PICO-8 color indices, the nearest to each pixel.
+    surf = SDL_CreateSurface(bmp->w * scale, bmp->h * scale, SDL_PIXELFORMAT_INDEX8);
+    if (!surf)
+    {
+        SDL_Log("SDL_CreateSurface: %s", SDL_GetError());
+        SDL_DestroySurface(bmp);
+        return NULL;
+    }
+    data = (Uint8*)surf->pixels;
+    for (int y = 0; y < bmp->h; y++)
+    {
+        for (int x = 0; x < bmp->w; x++)
+        {
+            Uint8 r = 0, g = 0, b = 0, a = 0;
+            Uint8 pix = 0;
+            int   best = 0x7fffffff;
+
+            SDL_ReadSurfacePixel(bmp, x, y, &r, &g, &b, &a);
+            for (int c = 0; c < 16; c++)
+            {
+                int dr = r - palette[c].r;
+                int dg = g - palette[c].g;
+                int db = b - palette[c].b;
+                int d = dr * dr + dg * dg + db * db;
+
+                if (d < best)
+                {
+                    best = d;
+                    pix = (Uint8)c;
+                }
+            }
+            for (int i = 0; i < scale; i++)
+            {
+                for (int j = 0; j < scale; j++)
+                {
+                    data[(x * scale + i) + (y * scale + j) * surf->pitch] = pix;
+                }
+            }
+        }
+    }
+    SDL_DestroySurface(bmp);
+
+    return surf;
+}
+
+// indices are w by h, a byte per pixel, as Sprite_LoadIndexed() makes them.
+SDL_Surface* Sprite_CreateIndexed(const Uint8* indices, int w, int h, int scale)
+{
+    SDL_Surface* surf = SDL_CreateSurface(w * scale, h * scale, SDL_PIXELFORMAT_INDEX8);
+
+    if (!surf)
+    {
+        SDL_Log("SDL_CreateSurface: %s", SDL_GetError());
+        return NULL;
+    }
+    for (int y = 0; y < surf->h; y++)
+    {
+        const Uint8* src = indices + (y / scale) * w;
+        Uint8*       dst = (Uint8*)surf->pixels + y * surf->pitch;
+
+        if (scale == 1)
+        {
+            SDL_memcpy(dst, src, w);
+            continue;
+        }
+        for (int x = 0; x < surf->w; x++)
+        {
+            dst[x] = src[x / scale];
+        }
+    }
+
+    return surf;
+}
+
+static const Uint8* TileRow(SDL_Surface* indexed, int tile_size, int tile, int row)
+{
+    int columns = indexed->w / tile_size;
+
+    return (const Uint8*)indexed->pixels + (tile % columns) * tile_size +
+           ((tile / columns) * tile_size + row) * indexed->pitch;
+}
+
+int Sprite_CreateSheet(Sprite_Sheet* sheet, SDL_Surface* indexed, int tile_size, int flags)
+{
+    int    variants = (flags & SPRITE_FLIP_X) ? 2 : 1;
+    int    colors = !(flags & SPRITE_SHAPE);
+    int    tiles, t, f, r, x;
+    Uint32 span_count = 0, pixel_count = 0;
+
+    SDL_assert(SDL_BYTESPERPIXEL(indexed->format) == 1);
+    SDL_memset(sheet, 0, sizeof(*sheet));
+    if (tile_size <= 0 || tile_size > 0xffff)
+    {
+        return false;
+    }
+
+    // Counted once, flipped copies take as much again.
+    tiles = (indexed->w / tile_size) * (indexed->h / tile_size);
+    for (t = 0; t < tiles; t++)
+    {
+        for (r = 0; r < tile_size; r++)
+        {
+            const Uint8* src = TileRow(indexed, tile_size, t, r);
+
+            for (x = 0; x < tile_size; x++)
+            {
+                if (src[x])
+                {
+                    span_count += x == 0 || !src[x - 1];
+                    pixel_count++;
+                }
+            }
+        }
+    }
+
+    sheet->rows = SDL_malloc(((size_t)tiles * variants * tile_size + 1) * sizeof(*sheet->rows));
+    sheet->spans = SDL_malloc((span_count * variants + 1) * sizeof(*sheet->spans));
+    sheet->pixels = SDL_malloc(pixel_count * variants * colors + 1);
+    sheet->bounds = SDL_malloc((tiles + 1) * sizeof(*sheet->bounds));
+    if (!sheet->rows || !sheet->spans || !sheet->pixels || !sheet->bounds)
+    {
+        SDL_Log("Out of memory for sprite sheet");
+        Sprite_DestroySheet(sheet);
+        return false;
+    }
+    sheet->tile_size = tile_size;
+    sheet->tiles = tiles;
+    sheet->variants = variants;
+    sheet->flags = flags;
+
+    span_count = pixel_count = 0;
+    for (t = 0; t < tiles; t++)
+    {
+        int x0 = tile_size, y0 = tile_size, x1 = 0, y1 = 0;
+
+        for (f = 0; f < variants; f++)
+        {
+            for (r = 0; r < tile_size; r++)
+            {
+                const Uint8* src = TileRow(indexed, tile_size, t, r);
+
+                sheet->rows[(t * variants + f) * tile_size + r] = span_count;
+                for (x = 0; x < tile_size; x++)
+                {
+                    Uint8 p = src[f ? tile_size - 1 - x : x];
+
+                    if (!p)
+                    {
+                        continue;
+                    }
+                    if (x == 0 || !src[f ? tile_size - x : x - 1])
+                    {
+                        sheet->spans[span_count].x = (Uint16)x;
+                        sheet->spans[span_count].len = 0;
+                        sheet->spans[span_count].pixels = pixel_count;
+                        span_count++;
+                    }
+                    sheet->spans[span_count - 1].len++;
+                    if (colors)
+                    {
+                        sheet->pixels[pixel_count++] = p;
+                    }
+
+                    if (!f)
+                    {
+                        x0 = SDL_min(x0, x);
+                        x1 = SDL_max(x1, x + 1);
+                        y0 = SDL_min(y0, r);
+                        y1 = SDL_max(y1, r + 1);
+                    }
+                }
+            }
+        }
+        sheet->bounds[t].x = x0;
+        sheet->bounds[t].y = y0;
+        sheet->bounds[t].w = SDL_max(x1 - x0, 0);
+        sheet->bounds[t].h = SDL_max(y1 - y0, 0);
+    }
+    sheet->rows[tiles * variants * tile_size] = span_count;
+    sheet->bytes = ((size_t)tiles * variants * tile_size + 1) * sizeof(*sheet->rows) +
+                   span_count * sizeof(*sheet->spans) + pixel_count + tiles * sizeof(*sheet->bounds);
+
+    return true;
+}
+
+void Sprite_DestroySheet(Sprite_Sheet* sheet)
+{
+    SDL_free(sheet->rows);
+    SDL_free(sheet->spans);
+    SDL_free(sheet->pixels);
+    SDL_free(sheet->bounds);
+    SDL_memset(sheet, 0, sizeof(*sheet));
+}
+
+// Draws the opaque pixels of tile at x, y, clipped to dst.  color -1
+// draws the tile's colors through lut, or as they are without one, any
+// other color fills every opaque pixel.  drawn gets the pixels touched.
+static int DrawTile(const Sprite_Sheet* sheet, int tile, SDL_Surface* dst, int x, int y,
+                    const Uint8* lut, int color, int flip, SDL_Rect* drawn)
+{
+    const Uint32* rows;
+    SDL_Rect box;
+    int ts = sheet->tile_size;
+    int left, right, top, bottom, dy;
+
+    SDL_assert(SDL_BYTESPERPIXEL(dst->format) == 1);
+    if (tile < 0 || tile >= sheet->tiles || !sheet->bounds[tile].w)
+    {
+        return false;
+    }
+    SDL_assert(!(flip & SPRITE_FLIP_X) || sheet->variants == 2);
+    SDL_assert(color >= 0 || !(sheet->flags & SPRITE_SHAPE));
+
+    box = sheet->bounds[tile];
+    if (flip & SPRITE_FLIP_X)
+    {
+        box.x = ts - box.x - box.w;
+    }
+    if (flip & SPRITE_FLIP_Y)
+    {
+        box.y = ts - box.y - box.h;
+    }
+    box.x += x;
+    box.y += y;
+    left = SDL_max(box.x, 0);
+    right = SDL_min(box.x + box.w, dst->w);
+    top = SDL_max(box.y, 0);
+    bottom = SDL_min(box.y + box.h, dst->h);
+    if (left >= right || top >= bottom)
+    {
+        return false;
+    }
+
+    rows = sheet->rows + (tile * sheet->variants + (flip & SPRITE_FLIP_X)) * ts;
+    for (dy = top; dy < bottom; dy++)
+    {
+        int                r = (flip & SPRITE_FLIP_Y) ? ts - 1 - (dy - y) : dy - y;
+        Uint8*             out = (Uint8*)dst->pixels + dy * dst->pitch;
+        const Sprite_Span* span = sheet->spans + rows[r];
+        const Sprite_Span* end = sheet->spans + rows[r + 1];
+
+        for (; span < end; span++)
+        {
+            const Uint8* src = sheet->pixels + span->pixels;
+            int          dx = x + span->x;
+            int          len = span->len;
+
+            if (dx < left)
+            {
+                src += left - dx;
+                len -= left - dx;
+                dx = left;
+            }
+            if (dx + len > right)
+            {
+                len = right - dx;
+            }
+            if (len <= 0)
+            {
+                continue;
+            }
+
+            if (color >= 0)
+            {
+                SDL_memset(out + dx, color, len);
+            }
+            else if (!lut)
+            {
+                SDL_memcpy(out + dx, src, len);
+            }
+            else
+            {
+                for (int i = 0; i < len; i++)
+                {
+                    out[dx + i] = lut[src[i] & 15];
+                }
+            }
+        }
+    }
+
+    if (drawn)
+    {
+        drawn->x = left;
+        drawn->y = top;
+        drawn->w = right - left;
+        drawn->h = bottom - top;
+    }
+    return true;
+}
+
+int Sprite_Draw(const Sprite_Sheet* sheet, int tile, SDL_Surface* dst, int x, int y, const Uint8* lut, int flip, SDL_Rect* drawn)
+{
+    return DrawTile(sheet, tile, dst, x, y, lut, -1, flip, drawn);
+}
+
+int Sprite_DrawSolid(const Sprite_Sheet* sheet, int tile, SDL_Surface* dst, int x, int y, Uint8 color, SDL_Rect* drawn)
+{
+    return DrawTile(sheet, tile, dst, x, y, NULL, color, 0, drawn);
+}
@@ -0,0 +1,52 @@
+/* @file sprite.h
+ *
+ * A C source port of the original Celeste game,
+ * highly optimized for the Nokia N-Gage.
+ *
+ * Original game by Maddy Makes Games.
+ * C source port by lemon32767.
+ *
+ * https://github.com/lemon32767/ccleste
+ *
+ */
+
+#ifndef SPRITE_H
+#define SPRITE_H
+
+#include <SDL3/SDL.h>
+
+#define SPRITE_FLIP_X 1
+#define SPRITE_FLIP_Y 2
+#define SPRITE_SHAPE  4 // Runs without colors, for Sprite_DrawSolid() only.
+
+typedef struct
+{
+    Uint16 x, len; // Position in the tile row and number of opaque pixels.
+    Uint32 pixels; // Offset of their colors in Sprite_Sheet.pixels.
+
+} Sprite_Span;
+
+typedef struct
+{
+    int          tile_size;
+    int          tiles;
+    int          variants; // 2 with the horizontally flipped runs, 1 without.
+    int          flags;    // As given to Sprite_CreateSheet().
+    size_t       bytes;    // Memory held by the arrays below.
+    Uint32*      rows;     // First span of each row, per tile and variant, and one past the last.
+    Sprite_Span* spans;
+    Uint8*       pixels;
+    SDL_Rect*    bounds;   // Opaque pixels of each tile, unflipped.
+
+} Sprite_Sheet;
+
+SDL_Surface* Sprite_LoadIndexed(const char* path, int scale, const SDL_Color palette[16]);
+SDL_Surface* Sprite_CreateIndexed(const Uint8* indices, int w, int h, int scale);
+
+int  Sprite_CreateSheet(Sprite_Sheet* sheet, SDL_Surface* indexed, int tile_size, int flags);
+void Sprite_DestroySheet(Sprite_Sheet* sheet);
+
+int Sprite_Draw(const Sprite_Sheet* sheet, int tile, SDL_Surface* dst, int x, int y, const Uint8* lut, int flip, SDL_Rect* drawn);
+int Sprite_DrawSolid(const Sprite_Sheet* sheet, int tile, SDL_Surface* dst, int x, int y, Uint8 color, SDL_Rect* drawn);
+
+#endif // SPRITE_H
@@ -0,0 +1,169 @@
+/* @file trace.c
+ *
+ * A C source port of the original Celeste game,
+ * highly optimized for the Nokia N-Gage.
+ *
+ * Original game by Maddy Makes Games.
+ * C source port by lemon32767.
+ *
+ * https://github.com/lemon32767/ccleste
+ *
+ */
+
+ /*
+  * Event trace.
+  * Events go into a ring allocated by Trace_Init() and the oldest are
+  * overwritten once it is full, so recording costs a store per event and
+  * never allocates.  Trace_Save() writes what the ring holds in the Chrome
+  * Trace Event format, a JSON object with a "traceEvents" array, which
+  * chrome://tracing and Perfetto open:
+  *
+  *   {"name":"update","ph":"X","ts":1234.567,"dur":0.812,"pid":1,"tid":1,"args":{...}}
+  *
+  * Spans have phase "X" and instant events phase "i".  Times are in
+  * microseconds since the first event the ring holds.  Until Trace_Init()
+  * succeeds, the other functions do nothing.
+  */
+
+#include "trace.h"
+
+static Trace_Event* events = NULL;
+static Uint32       capacity = 0;
+static Uint64       recorded = 0; // Events since Trace_Init(), the last capacity of them are held.
+
+int Trace_Init(int size)
+{
+    Trace_Destroy();
+    events = size > 0 ? SDL_calloc((size_t)size, sizeof(*events)) : NULL;
+    if (!events)
+    {
+        SDL_Log("Couldn't allocate a trace of %d events", size);
+        return false;
+    }
+    capacity = (Uint32)size;
+    return true;
+}
+
+static Trace_Event* Add(char phase, const char* name, const char* keys, int a, int b)
+{
+    Trace_Event* event = &events[recorded++ % capacity];
+
+    event->phase = phase;
+    event->name = name;
+    event->keys = keys;
+    event->args[0] = a;
+    event->args[1] = b;
+    return event;
+}
+
+void Trace_Span(const char* name, Uint64 start, Uint64 end, const char* keys, int a, int b)
+{
+    if (events)
+    {
+        Trace_Event* event = Add('X', name, keys, a, b);
+
+        event->start = start;
+        event->duration = (Uint32)SDL_min(end - start, SDL_MAX_UINT32);
+    }
+}
+
+void Trace_Instant(const char* name, const char* keys, int a, int b)
+{
+    if (events)
+    {
+        Trace_Event* event = Add('i', name, keys, a, b);
+
+        event->start = SDL_GetPerformanceCounter();
+        event->duration = 0;
+    }
+}
+
+// Writes {"key":a,"key":b} for the comma separated keys.
+static void WriteArgs(SDL_IOStream* io, const Trace_Event* event)
+{
+    const char* key = event->keys;
+    int         i;
+
+    SDL_IOprintf(io, ",\"args\":{");
+    for (i = 0; key && i < 2; i++)
+    {
+        const char* comma = SDL_strchr(key, ',');
+        int         length = comma ? (int)(comma - key) : (int)SDL_strlen(key);
+
+        SDL_IOprintf(io, "%s\"%.*s\":%d", i ? "," : "", length, key, event->args[i]);
+        key = comma ? comma + 1 : NULL;
+    }
+    SDL_IOprintf(io, "}");
+}
+
+int Trace_Save(const char* path)
+{
+    const double  us = 1e6 / SDL_GetPerformanceFrequency();
+    Uint64        held = SDL_min(recorded, capacity);
+    Uint64        seq;
+    Uint64        origin = 0;
+    SDL_IOStream* io;
+    int           ok;
+
+    if (!events)
+    {
+        return false;
+    }
+    io = SDL_IOFromFile(path, "w");
+    if (!io)
+    {
+        SDL_Log("Couldn't write trace '%s': %s", path, SDL_GetError());
+        return false;
+    }
+
+    // Spans are added when they end, so the oldest may start after a
+    // later one: take the earliest start as zero.
+    for (seq = recorded - held; seq < recorded; seq++)
+    {
+        const Trace_Event* event = &events[seq % capacity];
+
+        if (seq == recorded - held || event->start < origin)
+        {
+            origin = event->start;
+        }
+    }
+
+    SDL_IOprintf(io, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+    for (seq = recorded - held; seq < recorded; seq++)
+    {
+        const Trace_Event* event = &events[seq % capacity];
+
+        SDL_IOprintf(io, "%s\n{\"name\":\"%s\",\"ts\":%.3f,", seq == recorded - held ? "" : ",", event->name,
+                     (event->start - origin) * us);
+        if (event->phase == 'X')
+        {
+            SDL_IOprintf(io, "\"ph\":\"X\",\"dur\":%.3f,", event->duration * us);
+        }
+        else
+        {
+            SDL_IOprintf(io, "\"ph\":\"i\",\"s\":\"t\",");
+        }
+        SDL_IOprintf(io, "\"pid\":1,\"tid\":1");
+        WriteArgs(io, event);
+        SDL_IOprintf(io, "}");
+    }
+    SDL_IOprintf(io, "\n]}\n");
+    ok = SDL_GetIOStatus(io) != SDL_IO_STATUS_ERROR;
+    ok = SDL_CloseIO(io) && ok;
+    if (!ok)
+    {
+        SDL_Log("Couldn't write trace '%s': %s", path, SDL_GetError());
+        return false;
+    }
+
+    SDL_Log("trace: %u events written to %s, %u older dropped", (unsigned)held, path, (unsigned)(recorded - held));
+    return true;
+}
+
+void Trace_Destroy(void)
+{
+    SDL_free(events);
+    events = NULL;
+    capacity = 0;
+    recorded = 0;
+}
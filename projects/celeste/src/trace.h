@@ -0,0 +1,35 @@
+/* @file trace.h
+ *
+ * A C source port of the original Celeste game,
+ * highly optimized for the Nokia N-Gage.
+ *
+ * Original game by Maddy Makes Games.
+ * C source port by lemon32767.
+ *
+ * https://github.com/lemon32767/ccleste
+ *
+ */
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <SDL3/SDL.h>
+
+typedef struct
+{
+    const char* name;     // Static strings, like the keys.
+    const char* keys;     // Names of the arguments separated by a comma, NULL for none.
+    Uint64      start;    // SDL_GetPerformanceCounter() ticks.
+    Uint32      duration; // Likewise.
+    char        phase;    // 'X' for a span, 'i' for an instant event.
+    int         args[2];
+
+} Trace_Event;
+
+int  Trace_Init(int capacity);
+void Trace_Span(const char* name, Uint64 start, Uint64 end, const char* keys, int a, int b);
+void Trace_Instant(const char* name, const char* keys, int a, int b);
+int  Trace_Save(const char* path);
+void Trace_Destroy(void);
+
+#endif // TRACE_H